@@ -1,6 +1,45 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <iomanip>   // For std::setw in the sweep table
+#include <climits>   // For INT_MAX
+#include <cstdlib>   // For std::strtod / std::strtoull / std::atoi
+#include <algorithm> // For std::sort
+#include <cctype>    // For std::tolower
+#include <numeric>   // For std::accumulate
+#include <cmath>     // For std::sqrt
+#include <utility>   // For std::pair
+#include <cstring>   // For std::memcpy
+#include <cerrno>    // For errno
+#include <new>       // For std::bad_alloc
+#include <fstream>   // For the peak table and sysfs
+#include <sstream>   // For std::ostringstream / std::istringstream
+#include <cstdio>    // For std::snprintf
+#include <thread>    // For the multi-device run
+#include <mutex>
+#include <condition_variable>
+#include <map>       // For the tuning cache
+#include <filesystem> // For the binary cache directory
+#include <iterator>  // For std::istreambuf_iterator
+#include <cstdint>   // For uint64_t
+#include <array>     // For the trace timestamps
+#include <ctime>     // For result timestamps
+#include <random>    // For the gather/scatter index permutation
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h> // AVX2 / AVX-512 host baseline
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>  // NEON host baseline
+#endif
+#ifdef __linux__
+#include <pthread.h>   // For pinning host baseline threads
+#include <sched.h>
+#include <sys/resource.h> // For the peak resident set size
+#include <sys/mman.h>  // For the memory-mapped file path
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dlfcn.h>     // For loading NVML for energy sampling
+#endif
 
 // Define CL_HPP_TARGET_OPENCL_VERSION to suppress warning and explicitly target OpenCL 3.0
 #define CL_HPP_TARGET_OPENCL_VERSION 300
@@ -23,15 +62,5425 @@ static const std::string opencl_kernel = R"(
             C[id] = A[id] + B[id];
         }
     }
+
+    // Vector variants: each work-item adds W consecutive elements with vloadW/vstoreW,
+    // the last work-item falls back to scalar adds for the tail
+    #define VECADD_VECTOR(W)                                                        \
+    __kernel void vecadd_int##W                                                     \
+    (                                                                               \
+        __global const int *A,                                                      \
+        __global const int *B,                                                      \
+        __global int *C,                                                            \
+        const int N                                                                 \
+    )                                                                               \
+    {                                                                               \
+        int id = get_global_id(0);                                                  \
+        int base = id * W;                                                          \
+        if (base + W <= N) {                                                        \
+            vstore##W(vload##W(id, A) + vload##W(id, B), id, C);                    \
+        } else {                                                                    \
+            for (int i = base; i < N; ++i) {                                        \
+                C[i] = A[i] + B[i];                                                 \
+            }                                                                       \
+        }                                                                           \
+    }
+    VECADD_VECTOR(4)
+    VECADD_VECTOR(8)
+    VECADD_VECTOR(16)
+
+    // Grid-stride variant: a fixed number of work-groups loops over the whole array
+    __kernel void vecadd_grid_stride
+    (
+        __global const int *A,
+        __global const int *B,
+        __global int *C,
+        const int N
+    )
+    {
+        for (int i = get_global_id(0); i < N; i += get_global_size(0)) {
+            C[i] = A[i] + B[i];
+        }
+    }
+
+    // Unrolled variants: each work-item adds U elements spaced one global size apart,
+    // so neighbouring work-items still touch neighbouring addresses
+    #define VECADD_UNROLL(U)                                                        \
+    __kernel void vecadd_unroll##U                                                  \
+    (                                                                               \
+        __global const int *A,                                                      \
+        __global const int *B,                                                      \
+        __global int *C,                                                            \
+        const int N                                                                 \
+    )                                                                               \
+    {                                                                               \
+        int id = get_global_id(0);                                                  \
+        int stride = get_global_size(0);                                            \
+        for (int k = 0; k < U; ++k) {                                               \
+            int i = id + k * stride;                                                \
+            if (i < N) {                                                            \
+                C[i] = A[i] + B[i];                                                 \
+            }                                                                       \
+        }                                                                           \
+    }
+    VECADD_UNROLL(4)
+    VECADD_UNROLL(8)
+
+    // vecadd over a 2D NDRange for fused batches: dimension 1 selects the job, dimension 0 the
+    // element within it
+    __kernel void vecadd_batched
+    (
+        __global const int *A,
+        __global const int *B,
+        __global int *C,
+        const int jobElements
+    )
+    {
+        int i = get_global_id(1) * jobElements + get_global_id(0);
+        C[i] = A[i] + B[i];
+    }
+
+    // Roofline probe: `fmas` multiply-adds per element over four independent chains, against one
+    // 4-byte load and one 4-byte store, i.e. fmas / 4 FLOP per byte. The result is written as the
+    // float's bit pattern so no conversion is added to the store.
+    __kernel void roofline_fma
+    (
+        __global const int *A,
+        __global int *C,
+        const int N,
+        const int fmas
+    )
+    {
+        int i = get_global_id(0);
+        if (i < N) {
+            float a = (float)A[i];
+            float b = a * 0.5f;
+            float x0 = a, x1 = a + 1.0f, x2 = a + 2.0f, x3 = a + 3.0f;
+            int k = 0;
+            for (; k + 4 <= fmas; k += 4) {
+                x0 = fma(x0, a, b);
+                x1 = fma(x1, a, b);
+                x2 = fma(x2, a, b);
+                x3 = fma(x3, a, b);
+            }
+            for (; k < fmas; ++k) {
+                x0 = fma(x0, a, b);
+            }
+            C[i] = as_int(x0 + x1 + x2 + x3);
+        }
+    }
+
+    // Access-pattern probes: the same C = A + B per element as vecadd, only the addresses differ.
+    // Strided walks the array column by column as a (N / stride) x stride matrix, so neighbouring
+    // work-items are `stride` elements apart but every element is still touched once; the host
+    // keeps N a multiple of stride.
+    __kernel void access_strided
+    (
+        __global const int *A,
+        __global const int *B,
+        __global int *C,
+        const int N,
+        const int stride
+    )
+    {
+        int i = get_global_id(0);
+        if (i < N) {
+            int rows = N / stride;
+            int j = (i % rows) * stride + i / rows;
+            C[j] = A[j] + B[j];
+        }
+    }
+
+    // Gather: reads through a random index buffer, writes coalesced
+    __kernel void access_gather
+    (
+        __global const int *A,
+        __global const int *B,
+        __global int *C,
+        __global const int *index,
+        const int N
+    )
+    {
+        int i = get_global_id(0);
+        if (i < N) {
+            int j = index[i];
+            C[i] = A[j] + B[j];
+        }
+    }
+
+    // Scatter: reads coalesced, writes through a random index buffer
+    __kernel void access_scatter
+    (
+        __global const int *A,
+        __global const int *B,
+        __global int *C,
+        __global const int *index,
+        const int N
+    )
+    {
+        int i = get_global_id(0);
+        if (i < N) {
+            C[index[i]] = A[i] + B[i];
+        }
+    }
+
+    // Array-of-structs form of c = a + b over a struct with one field the operation does not use;
+    // the struct-of-arrays form of the same operation is vecadd over the a, b and c columns
+    typedef struct { int a; int b; int c; int unused; } AccessItem;
+    __kernel void access_aos
+    (
+        __global AccessItem *items,
+        const int N
+    )
+    {
+        int i = get_global_id(0);
+        if (i < N) {
+            items[i].c = items[i].a + items[i].b;
+        }
+    }
+
+    // Does nothing; used to measure the fixed cost of a launch
+    __kernel void empty_kernel()
+    {
+    }
+
+    // Per-work-group partial sums of C for checksum verification; the local size must be a power of two
+    __kernel void checksum_partials
+    (
+        __global const int *C,
+        __global long *partials,
+        __local long *scratch,
+        const int N
+    )
+    {
+        long sum = 0;
+        for (int i = get_global_id(0); i < N; i += get_global_size(0)) {
+            sum += C[i];
+        }
+        int lid = get_local_id(0);
+        scratch[lid] = sum;
+        barrier(CLK_LOCAL_MEM_FENCE);
+        for (int half = get_local_size(0) / 2; half > 0; half >>= 1) {
+            if (lid < half) {
+                scratch[lid] += scratch[lid + half];
+            }
+            barrier(CLK_LOCAL_MEM_FENCE);
+        }
+        if (lid == 0) {
+            partials[get_group_id(0)] = scratch[0];
+        }
+    }
+)";
+
+// Default problem size used when no sweep is requested
+static const int DATA_SIZE = 1024 * 1024; // 1M elements for demonstration (approx. 4MB)
+
+// How the A/B/C data is made visible to the device
+enum class BufferStrategy {
+    Copy,         // enqueueWriteBuffer/enqueueReadBuffer into device-allocated buffers
+    UseHostPtr,   // CL_MEM_USE_HOST_PTR over page-aligned host vectors, synchronized with map/unmap
+    AllocHostPtr, // CL_MEM_ALLOC_HOST_PTR buffers filled and drained through enqueueMapBuffer
+    Svm,          // Coarse-grained SVM allocations synchronized with enqueueMapSVM
+};
+
+static const BufferStrategy ALL_STRATEGIES[] = {
+    BufferStrategy::Copy, BufferStrategy::UseHostPtr, BufferStrategy::AllocHostPtr, BufferStrategy::Svm,
+};
+
+static const char* strategy_name(BufferStrategy strategy) {
+    switch (strategy) {
+        case BufferStrategy::Copy: return "copy";
+        case BufferStrategy::UseHostPtr: return "use-host-ptr";
+        case BufferStrategy::AllocHostPtr: return "alloc-host-ptr";
+        case BufferStrategy::Svm: return "svm";
+    }
+    return "unknown";
+}
+
+// Shape of the vecadd kernel run by the pipeline
+enum class KernelVariant {
+    Scalar,          // One int per work-item (the original vecadd)
+    Int4,            // vload4/vstore4 per work-item
+    Int8,
+    Int16,
+    GridStride,      // Fixed number of work-groups looping over the array
+    Unroll4,         // Four coalesced elements per work-item
+    Unroll8,
+    PreferredVector, // Resolved per device from CL_DEVICE_PREFERRED_VECTOR_WIDTH_INT
+};
+
+static const KernelVariant ALL_VARIANTS[] = {
+    KernelVariant::Scalar, KernelVariant::Int4, KernelVariant::Int8, KernelVariant::Int16,
+    KernelVariant::GridStride, KernelVariant::Unroll4, KernelVariant::Unroll8,
+};
+
+static const char* variant_name(KernelVariant variant) {
+    switch (variant) {
+        case KernelVariant::Scalar: return "scalar";
+        case KernelVariant::Int4: return "int4";
+        case KernelVariant::Int8: return "int8";
+        case KernelVariant::Int16: return "int16";
+        case KernelVariant::GridStride: return "grid-stride";
+        case KernelVariant::Unroll4: return "unroll4";
+        case KernelVariant::Unroll8: return "unroll8";
+        case KernelVariant::PreferredVector: return "vector";
+    }
+    return "unknown";
+}
+
+// Name of the __kernel function implementing the variant
+static const char* variant_kernel_name(KernelVariant variant) {
+    switch (variant) {
+        case KernelVariant::Int4: return "vecadd_int4";
+        case KernelVariant::Int8: return "vecadd_int8";
+        case KernelVariant::Int16: return "vecadd_int16";
+        case KernelVariant::GridStride: return "vecadd_grid_stride";
+        case KernelVariant::Unroll4: return "vecadd_unroll4";
+        case KernelVariant::Unroll8: return "vecadd_unroll8";
+        default: return "vecadd";
+    }
+}
+
+// Elements handled by each work-item (grid-stride is sized separately)
+static int variant_elements_per_item(KernelVariant variant) {
+    switch (variant) {
+        case KernelVariant::Int4: case KernelVariant::Unroll4: return 4;
+        case KernelVariant::Int8: case KernelVariant::Unroll8: return 8;
+        case KernelVariant::Int16: return 16;
+        default: return 1;
+    }
+}
+
+// Work-groups per compute unit launched by the grid-stride variant
+static const int GRID_STRIDE_GROUPS_PER_CU = 8;
+
+// Which buffer strategy and kernel variant one pipeline run uses
+struct PipelineConfig {
+    BufferStrategy strategy = BufferStrategy::Copy;
+    KernelVariant variant = KernelVariant::Scalar;
+    size_t localSize = 0; // 0 lets the driver choose
+};
+
+// Element types covered by the --types matrix
+enum class DataType {
+    Int,
+    Long,
+    Float,
+    Half,   // Needs cl_khr_fp16
+    Double, // Needs cl_khr_fp64
+};
+
+static const DataType ALL_DATA_TYPES[] = {
+    DataType::Int, DataType::Long, DataType::Float, DataType::Half, DataType::Double,
+};
+
+// OpenCL C spelling of the type, also used on the command line
+static const char* data_type_name(DataType type) {
+    switch (type) {
+    case DataType::Int: return "int";
+    case DataType::Long: return "long";
+    case DataType::Float: return "float";
+    case DataType::Half: return "half";
+    case DataType::Double: return "double";
+    }
+    return "unknown";
+}
+
+// Device extension the type depends on, or nullptr for core types
+static const char* data_type_extension(DataType type) {
+    if (type == DataType::Half) return "cl_khr_fp16";
+    if (type == DataType::Double) return "cl_khr_fp64";
+    return nullptr;
+}
+
+// Page size used to align host vectors so CL_MEM_USE_HOST_PTR buffers can be zero-copy
+static const size_t HOST_ALIGNMENT = 4096;
+
+// std::vector allocator returning HOST_ALIGNMENT-aligned storage padded to a whole number of pages
+template <typename T>
+struct PageAlignedAllocator {
+    using value_type = T;
+    PageAlignedAllocator() = default;
+    template <typename U> PageAlignedAllocator(const PageAlignedAllocator<U>&) {}
+    T* allocate(size_t n) {
+        size_t bytes = (n * sizeof(T) + HOST_ALIGNMENT - 1) / HOST_ALIGNMENT * HOST_ALIGNMENT;
+        void* ptr = std::aligned_alloc(HOST_ALIGNMENT, bytes);
+        if (!ptr) throw std::bad_alloc();
+        return static_cast<T*>(ptr);
+    }
+    void deallocate(T* ptr, size_t) { std::free(ptr); }
+};
+template <typename T, typename U>
+bool operator==(const PageAlignedAllocator<T>&, const PageAlignedAllocator<U>&) { return true; }
+template <typename T, typename U>
+bool operator!=(const PageAlignedAllocator<T>&, const PageAlignedAllocator<U>&) { return false; }
+
+using HostVector = std::vector<int, PageAlignedAllocator<int>>;
+
+// How the result of each measured pipeline run is checked
+enum class VerifyMode {
+    Full,     // Compare every element on the host
+    Checksum, // Reduce C on the device and compare against a host sum; only located on mismatch
+};
+
+// File format of --output
+enum class OutputFormat {
+    Auto,      // From the file extension: .csv is CSV, anything else JSON lines
+    JsonLines, // One JSON object per record and line
+    Csv,
+};
+
+// One line of the --peak-table file: "<device name substring>,<memory GB/s>[,<host link GB/s>]"
+struct PeakTableEntry {
+    std::string deviceMatch;
+    double memoryGBps = 0.0;
+    double linkGBps = 0.0;
+};
+
+// Options parsed from the command line
+struct BenchmarkOptions {
+    bool help = false;               // Print usage and exit
+    bool list = false;               // Only enumerate the selected platforms and devices
+    std::string platformSelector;    // Comma-separated platform indices / name substrings; empty = all
+    std::string deviceSelector;      // Comma-separated device indices / name substrings; empty = all
+    cl_device_type deviceType = CL_DEVICE_TYPE_ALL; // Device types passed to getDevices
+    bool sweep = false;              // Run a geometric series of sizes instead of DATA_SIZE only
+    size_t sweepMinBytes = 4 * 1024; // Smallest buffer size in the sweep
+    double sweepMaxFraction = 0.25;  // Largest buffer size as a fraction of CL_DEVICE_MAX_MEM_ALLOC_SIZE
+    double sweepFactor = 2.0;        // Ratio between consecutive sizes
+    double levelOffRatio = 0.9;      // Fraction of the best observed rate that counts as "levelled off"
+    int warmupIterations = 2;        // Untimed passes run before measuring
+    int iterations = 10;             // Timed passes per problem size
+    double cvWarnThreshold = 0.05;   // Warn when a phase's stddev / mean exceeds this
+    VerifyMode verifyMode = VerifyMode::Full; // How pipeline results are verified
+    std::string outputPath;          // Machine-readable result file; empty = none
+    OutputFormat outputFormat = OutputFormat::Auto;
+    std::string tracePath;           // Chrome trace JSON of every traced command; empty = none
+    std::string baselinePath;        // Earlier --output file to diff this run against; empty = none
+    double regressionThreshold = 0.05; // Median slowdown that counts as a regression
+    double significance = 0.05;      // Mann-Whitney p-value below which a delta is significant
+    std::vector<BufferStrategy> strategies = {BufferStrategy::Copy}; // Buffer strategies to compare
+    std::vector<KernelVariant> variants = {KernelVariant::Scalar};   // Kernel variants to compare
+    bool autotune = false;           // Sweep local work sizes for uncached kernels before benchmarking
+    bool retune = false;             // Sweep even kernels that already have a cached local size
+    std::string tuningCachePath = "benchmark_tuning.cache"; // Persisted tuned local sizes
+    bool hostBaseline = false;       // Also time native scalar / SIMD / multithreaded vecadd on the host
+    int hostThreads = 0;             // Threads for the multithreaded host baseline; 0 = every CPU the process may use
+    bool binaryCache = true;         // Reuse compiled program binaries across runs
+    std::string binaryCacheDir = "benchmark_binaries"; // Where compiled program binaries are kept
+    bool pinned = false;             // Also compare pageable vs pinned host staging bandwidth
+    std::vector<PeakTableEntry> peakTable; // User-supplied theoretical peaks
+    int launchCount = 0;             // > 0 runs the launch overhead microbenchmark with this many launches
+    int batchJobs = 0;               // > 0 compares batched submission strategies over this many jobs
+    int batchElements = 4096;        // Elements per batched job
+    std::vector<DataType> dataTypes; // Element types for the type matrix; empty = skip it
+    int fmaChain = 256;              // Dependent multiply-adds per element in the FMA kernels
+    bool roofline = false;           // Sweep arithmetic intensity and derive the ridge point
+    size_t rooflineBytes = 64 * 1024 * 1024; // Input size of the roofline sweep
+    int streamChunks = 0;            // > 0 runs the chunked streaming pipeline with this many chunks
+    int streamQueues = 3;            // Queues for the streaming pipeline; 1 = one out-of-order queue
+    size_t streamBytes = 64 * 1024 * 1024; // Size of each streamed input buffer
+    bool multiDevice = false;        // Run all devices concurrently on one shared problem
+    std::vector<double> splitRatios; // Static per-device split; empty = learn from single-device runs
+    size_t multiDeviceBytes = 64 * 1024 * 1024; // Size of each shared input buffer
+    int concurrencyStreams = 0;      // > 0 compares in-order queue counts and an out-of-order queue over this many streams
+    int concurrencyElements = 1 << 20; // Elements per concurrent stream
+    bool deviceCopies = false;       // Time copies between buffers of one device and buffer fills
+    bool peerTransfers = false;      // Time transfers between every pair of selected devices
+    size_t transferBytes = 64 * 1024 * 1024; // Size of each device and peer transfer
+    bool outOfCore = false;          // Stream a dataset larger than device memory through a bounded ring
+    size_t outOfCoreBytes = 0;       // Size of each out-of-core input; 0 = 1.5x CL_DEVICE_GLOBAL_MEM_SIZE
+    size_t outOfCoreChunkBytes = 64 * 1024 * 1024; // Size of each out-of-core chunk buffer
+    int outOfCoreSlots = 3;          // Out-of-core chunks in flight at once
+    std::string fileDir;             // Directory of the file I/O inputs and output; empty = skip it
+    size_t fileBytes = 256 * 1024 * 1024; // Size of generated file I/O inputs
+    bool fileWarm = false;           // Keep file I/O inputs in the page cache between passes
+    bool accessPatterns = false;     // Compare strided, gather/scatter and AoS/SoA access with coalesced vecadd
+    std::vector<int> accessStrides = {2, 4, 8, 16, 32}; // Element strides of the strided pattern
+    size_t accessBytes = 64 * 1024 * 1024; // Size of each access-pattern array
+    bool reductions = false;         // Benchmark sum/min/max reductions and exclusive scan
+    int reduceElements = 1 << 22;    // Elements reduced and scanned
+    bool specialize = false;         // Benchmark -D specialized vecadd binaries against generic ones
+    std::vector<DataType> specTypes = {DataType::Int}; // Element types of the specialized kernels
+    std::vector<int> specWidths = {1, 4, 8}; // Vector widths of the specialized kernels
+    std::vector<int> specUnrolls = {1, 4};   // Vectors per work-item of the specialized kernels
+    int specElements = DATA_SIZE;    // Compile-time element count of the specialized kernels
+    bool energy = false;             // Sample device energy around each benchmark phase
+    int energyIntervalMs = 20;       // Energy sampling period
+};
+
+// Summary statistics over the measured iterations of one phase (all values in ms)
+struct PhaseStats {
+    size_t count = 0;
+    double min = 0.0;
+    double max = 0.0;
+    double mean = 0.0;
+    double median = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double stddev = 0.0;
+    double cv = 0.0; // Coefficient of variation: stddev / mean
+    std::vector<double> samples; // The measured values, sorted ascending
+};
+
+// Outcome of checking C == A + B over a whole result
+struct VerifyResult {
+    bool correct = false;
+    bool viaChecksum = false;    // Accepted on the device checksum, without an element-by-element compare
+    size_t checked = 0;          // Elements covered by the check
+    size_t firstMismatch = 0;    // Index of the first wrong element (valid when !correct)
+    int expected = 0;
+    int actual = 0;
+    long long deviceSum = 0;     // Checksum mode only
+    long long hostSum = 0;
+};
+
+// Timings of the write/kernel/read passes run over one problem size
+struct PipelineResult {
+    int elements = 0;
+    PipelineConfig config;
+    PhaseStats writeA;
+    PhaseStats writeB;
+    PhaseStats kernel;
+    PhaseStats readC;
+    PhaseStats overall;
+    VerifyResult verify;
+
+    // Host-side breakdown of `overall` (ms)
+    PhaseStats uploadCalls;   // Host time inside the upload calls for A and B
+    PhaseStats kernelCall;    // enqueueNDRangeKernel
+    PhaseStats downloadCall;  // Blocking read (or map) of C
+    PhaseStats finishCall;    // queue.finish()
+    PhaseStats deviceBusy;    // Union of the START..END intervals of all commands
+    PhaseStats overhead;      // overall - deviceBusy: driver and scheduling cost
+    bool aligned = false;     // Device and host timelines aligned with clGetDeviceAndHostTimer
+    PhaseStats submitLatency; // First enqueue call -> first command START
+    PhaseStats deviceGaps;    // Device idle time between the first START and the last END
+    PhaseStats tailLatency;   // Last command END -> finish() returned
+};
+
+// Function to print OpenCL errors
+void print_cl_error(cl_int err) {
+    std::cerr << "OpenCL Error: " << err << std::endl;
+}
+
+// Returns the START -> END duration of a profiled event in milliseconds
+static double event_ms(const cl::Event& event) {
+    cl_ulong timeStart, timeEnd;
+    event.getProfilingInfo(CL_PROFILING_COMMAND_START, &timeStart);
+    event.getProfilingInfo(CL_PROFILING_COMMAND_END, &timeEnd);
+    return (double)(timeEnd - timeStart) * 1e-6;
+}
+
+// Converts a byte count moved in the given time into GB/s (1 GB = 1e9 bytes)
+static double gb_per_s(double bytes, double ms) {
+    return ms > 0.0 ? bytes / (ms * 1e6) : 0.0;
+}
+
+// Linearly interpolated percentile (0..100) of an already sorted sample set
+static double percentile(const std::vector<double>& sorted, double pct) {
+    if (sorted.empty()) return 0.0;
+    double rank = pct / 100.0 * (double)(sorted.size() - 1);
+    size_t lower = (size_t)rank;
+    size_t upper = lower + 1 < sorted.size() ? lower + 1 : lower;
+    double frac = rank - (double)lower;
+    return sorted[lower] + (sorted[upper] - sorted[lower]) * frac;
+}
+
+// Computes min/median/percentiles/stddev over the samples of one phase
+PhaseStats compute_stats(std::vector<double> samples) {
+    PhaseStats stats;
+    stats.count = samples.size();
+    if (samples.empty()) return stats;
+
+    std::sort(samples.begin(), samples.end());
+    stats.min = samples.front();
+    stats.max = samples.back();
+    stats.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / (double)samples.size();
+    stats.median = percentile(samples, 50.0);
+    stats.p95 = percentile(samples, 95.0);
+    stats.p99 = percentile(samples, 99.0);
+
+    double sumSq = 0.0;
+    for (double s : samples) sumSq += (s - stats.mean) * (s - stats.mean);
+    // Sample standard deviation; a single iteration has no spread to report
+    stats.stddev = samples.size() > 1 ? std::sqrt(sumSq / (double)(samples.size() - 1)) : 0.0;
+    stats.cv = stats.mean > 0.0 ? stats.stddev / stats.mean : 0.0;
+    stats.samples = std::move(samples);
+    return stats;
+}
+
+// Value written into C before the measured pass; vecadd of the benchmark inputs never produces it
+static const int VERIFY_POISON = -1;
+
+// Compares every element of C against A + B, split over all CPUs. Each thread scans its range in
+// blocks with a branch-free (vectorizable) compare and only rescans a block element by element
+// once it knows the block holds a mismatch.
+VerifyResult verify_vecadd(const int* A, const int* B, const int* C, size_t n) {
+    const size_t BLOCK = 4096;
+    unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+    threadCount = (unsigned)std::min<size_t>(threadCount, n / (16 * BLOCK) + 1);
+    size_t chunk = (n + threadCount - 1) / threadCount;
+    std::vector<size_t> firstBad(threadCount, SIZE_MAX);
+
+    auto scan = [&](unsigned t) {
+        size_t end = std::min(n, (t + 1) * chunk);
+        for (size_t block = t * chunk; block < end; block += BLOCK) {
+            size_t blockEnd = std::min(end, block + BLOCK);
+            int bad = 0;
+            for (size_t i = block; i < blockEnd; ++i) bad |= C[i] ^ (A[i] + B[i]);
+            if (!bad) continue;
+            for (size_t i = block; i < blockEnd; ++i) {
+                if (C[i] != A[i] + B[i]) { firstBad[t] = i; return; }
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < threadCount; ++t) threads.emplace_back(scan, t);
+    scan(0);
+    for (auto& thread : threads) thread.join();
+
+    VerifyResult result;
+    result.checked = n;
+    size_t mismatch = *std::min_element(firstBad.begin(), firstBad.end());
+    result.correct = mismatch == SIZE_MAX;
+    if (!result.correct) {
+        result.firstMismatch = mismatch;
+        result.expected = A[mismatch] + B[mismatch];
+        result.actual = C[mismatch];
+    }
+    return result;
+}
+
+// Sum of A + B computed on the host, for comparison against the device checksum of C
+static long long host_checksum(const int* A, const int* B, size_t n) {
+    long long sum = 0;
+    for (size_t i = 0; i < n; ++i) sum += (long long)A[i] + B[i];
+    return sum;
+}
+
+// One-line verdict for a verification, including where the first mismatch is
+std::string describe_verification(const VerifyResult& verify) {
+    std::ostringstream text;
+    if (verify.correct && verify.viaChecksum) {
+        text << "PASSED (device checksum of " << verify.checked << " elements matches host)";
+    } else if (verify.correct) {
+        text << "PASSED (all " << verify.checked << " elements are correct)";
+    } else {
+        text << "FAILED (";
+        if (verify.viaChecksum) text << "device checksum " << verify.deviceSum << " != host " << verify.hostSum << "; ";
+        text << "first mismatch at element " << verify.firstMismatch << ": expected "
+             << verify.expected << ", got " << verify.actual << ")";
+    }
+    return text.str();
+}
+
+// How long building a program took and which path produced it
+struct BuildStats {
+    double sourceMs = 0.0; // Compile from source (cold); 0 if not done
+    double binaryMs = 0.0; // Load + build from a cached binary (warm); 0 if not done
+    bool fromCache = false;
+};
+
+// 64-bit FNV-1a hash used to name cached program binaries
+static uint64_t fnv1a(const std::string& data, uint64_t hash = 1469598103934665603ULL) {
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Path of the cached binary for this source / build options / device / driver combination
+static std::string binary_cache_path(const cl::Device& device, const std::string& source,
+                                     const std::string& buildOptions, const BenchmarkOptions& options) {
+    std::string vendor, deviceName, deviceVersion, driverVersion;
+    device.getInfo(CL_DEVICE_VENDOR, &vendor);
+    device.getInfo(CL_DEVICE_NAME, &deviceName);
+    device.getInfo(CL_DEVICE_VERSION, &deviceVersion);
+    device.getInfo(CL_DRIVER_VERSION, &driverVersion);
+    std::string identity = source + '\0' + buildOptions + '\0' + vendor + '\0' + deviceName + '\0' +
+                           deviceVersion + '\0' + driverVersion;
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)fnv1a(identity));
+    return options.binaryCacheDir + "/" + name;
+}
+
+// Prints the build log of a program that failed to build
+static void print_build_log(const cl::Program& program, const cl::Device& device) {
+    std::string buildLog;
+    program.getBuildInfo(device, CL_PROGRAM_BUILD_LOG, &buildLog);
+    std::cerr << "Build Log:\n" << buildLog << std::endl;
+}
+
+// Creates `program` from a cached binary; returns false (quietly) when the binary is missing or rejected
+static bool load_program_binary(const cl::Context& context, const cl::Device& device, const std::string& path,
+                                const std::string& buildOptions, cl::Program& program) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    cl::Program::Binaries binaries(1);
+    binaries[0].assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    if (binaries[0].empty()) return false;
+
+    cl_int err;
+    std::vector<cl_int> binaryStatus;
+    program = cl::Program(context, {device}, binaries, &binaryStatus, &err);
+    if (err != CL_SUCCESS) return false;
+    // Binaries still need clBuildProgram, which is usually just a link step
+    return program.build({device}, buildOptions.c_str()) == CL_SUCCESS;
+}
+
+// Saves the device binary of a built program. It is written to a temporary file unique to this
+// process and thread and renamed into place only once fully written, so concurrent runs never
+// see a partial binary
+static void save_program_binary(const cl::Program& program, const std::string& path) {
+    cl::Program::Binaries binaries;
+    if (program.getInfo(CL_PROGRAM_BINARIES, &binaries) != CL_SUCCESS || binaries.empty() || binaries[0].empty()) return;
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+    // The thread keeps identical devices of one --multi-device run apart; they share a cache key
+    std::string suffix = std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+#ifdef __linux__
+    suffix = std::to_string(getpid()) + "." + suffix;
+#else
+    suffix = std::to_string(std::random_device{}()) + "." + suffix;
+#endif
+    std::string tmpPath = path + "." + suffix + ".tmp";
+    bool written;
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file) return;
+        file.write(reinterpret_cast<const char*>(binaries[0].data()), (std::streamsize)binaries[0].size());
+        file.close();
+        written = !file.fail();
+    }
+    if (!written || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Warning: could not save program binary to " << path << std::endl;
+        std::remove(tmpPath.c_str());
+    }
+}
+
+// Builds `source` for one device, going through the on-disk binary cache unless it is disabled.
+// On a cache miss the fresh binary is saved and immediately reloaded so both the cold (source)
+// and warm (binary) build times are reported.
+bool build_program(const cl::Context& context, const cl::Device& device, const std::string& source,
+                   const std::string& buildOptions, const BenchmarkOptions& options,
+                   cl::Program& program, BuildStats& stats) {
+    std::string cachePath;
+    if (options.binaryCache) {
+        cachePath = binary_cache_path(device, source, buildOptions, options);
+        auto start = std::chrono::steady_clock::now();
+        if (load_program_binary(context, device, cachePath, buildOptions, program)) {
+            stats.binaryMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            stats.fromCache = true;
+            return true;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    program = cl::Program(context, source);
+    cl_int err = program.build({device}, buildOptions.c_str());
+    if (err != CL_SUCCESS) {
+        print_cl_error(err);
+        std::string deviceName;
+        device.getInfo(CL_DEVICE_NAME, &deviceName);
+        std::cerr << "Failed to build kernel program for device: " << deviceName << std::endl;
+        // Print build log for debugging if building fails
+        print_build_log(program, device);
+        return false;
+    }
+    stats.sourceMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if (options.binaryCache) {
+        save_program_binary(program, cachePath);
+        cl::Program warm;
+        auto warmStart = std::chrono::steady_clock::now();
+        if (load_program_binary(context, device, cachePath, buildOptions, warm)) {
+            stats.binaryMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - warmStart).count();
+        }
+    }
+    return true;
+}
+
+// Prints the cold and/or warm build time of a program
+void print_build_stats(const BuildStats& stats) {
+    std::cout << "Program build: ";
+    if (stats.fromCache) {
+        std::cout << stats.binaryMs << " ms from cached binary (warm)" << std::endl;
+        return;
+    }
+    std::cout << stats.sourceMs << " ms from source (cold)";
+    if (stats.binaryMs > 0.0) std::cout << ", " << stats.binaryMs << " ms from binary (warm)";
+    std::cout << std::endl;
+}
+
+// Returns true if the device can run the given buffer strategy
+bool strategy_supported(const cl::Device& device, BufferStrategy strategy) {
+    if (strategy != BufferStrategy::Svm) return true;
+    // Pre-2.0 devices reject the query, which also means no SVM
+    cl_device_svm_capabilities svmCaps = 0;
+    if (device.getInfo(CL_DEVICE_SVM_CAPABILITIES, &svmCaps) != CL_SUCCESS) return false;
+    return (svmCaps & CL_DEVICE_SVM_COARSE_GRAIN_BUFFER) != 0;
+}
+
+// Device buffers kept for reuse across trials and sizes. Buffers are bucketed by their flags and
+// their capacity, which is rounded up to a power of two, so a later request of a similar size
+// finds a free buffer instead of allocating.
+struct BufferPool {
+    cl::Context context;
+    std::multimap<std::pair<cl_mem_flags, size_t>, cl::Buffer> free;
+    size_t allocations = 0;
+    size_t reuses = 0;
+    double allocationMs = 0.0; // Host time spent creating buffers on pool misses
+
+    // Capacity of the bucket that holds requests of `bytes`
+    static size_t bucket_size(size_t bytes) {
+        size_t capacity = HOST_ALIGNMENT;
+        while (capacity < bytes) capacity *= 2;
+        return capacity;
+    }
+
+    // Hands out a free buffer of the bucket, or creates one
+    cl_int acquire(cl_mem_flags flags, size_t bytes, cl::Buffer& buffer) {
+        auto found = free.find({flags, bucket_size(bytes)});
+        if (found != free.end()) {
+            buffer = found->second;
+            free.erase(found);
+            reuses++;
+            return CL_SUCCESS;
+        }
+        cl_int err;
+        auto start = std::chrono::steady_clock::now();
+        buffer = cl::Buffer(context, flags, bucket_size(bytes), nullptr, &err);
+        if (err != CL_SUCCESS && !free.empty()) {
+            // Out of device memory: drop the idle buffers and try once more
+            free.clear();
+            buffer = cl::Buffer(context, flags, bucket_size(bytes), nullptr, &err);
+        }
+        allocationMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (err == CL_SUCCESS) allocations++;
+        return err;
+    }
+
+    // Returns a buffer obtained from acquire() with the same flags and bytes
+    void release(cl_mem_flags flags, size_t bytes, const cl::Buffer& buffer) {
+        free.insert({{flags, bucket_size(bytes)}, buffer});
+    }
+};
+
+// Device-visible storage for A, B and C under one buffer strategy
+struct PipelineBuffers {
+    BufferStrategy strategy = BufferStrategy::Copy;
+    cl::Context context;
+    cl::Buffer d_A, d_B, d_C;
+    int* svmA = nullptr;
+    int* svmB = nullptr;
+    int* svmC = nullptr;
+    // Set when d_A/d_B/d_C came from a pool; they go back to it on destruction
+    BufferPool* pool = nullptr;
+    cl_mem_flags inputFlags = 0;
+    cl_mem_flags outputFlags = 0;
+    size_t bytes = 0;
+
+    PipelineBuffers() = default;
+    PipelineBuffers(const PipelineBuffers&) = delete;
+    PipelineBuffers& operator=(const PipelineBuffers&) = delete;
+    ~PipelineBuffers() {
+        if (svmA) clSVMFree(context(), svmA);
+        if (svmB) clSVMFree(context(), svmB);
+        if (svmC) clSVMFree(context(), svmC);
+        if (pool) {
+            if (d_A()) pool->release(inputFlags, bytes, d_A);
+            if (d_B()) pool->release(inputFlags, bytes, d_B);
+            if (d_C()) pool->release(outputFlags, bytes, d_C);
+        }
+    }
+};
+
+// Creates the device-allocated A/B/C buffers of the copy and alloc-host-ptr strategies, from the
+// pool when one is given
+static bool create_device_buffers(const cl::Context& context, cl_mem_flags inputFlags, cl_mem_flags outputFlags,
+                                  size_t bytes, BufferPool* pool, PipelineBuffers& buffers) {
+    cl_int err = CL_SUCCESS;
+    if (pool) {
+        buffers.pool = pool;
+        buffers.inputFlags = inputFlags;
+        buffers.outputFlags = outputFlags;
+        buffers.bytes = bytes;
+    }
+    auto create = [&](cl_mem_flags flags, cl::Buffer& buffer) {
+        if (pool) return pool->acquire(flags, bytes, buffer);
+        buffer = cl::Buffer(context, flags, bytes, nullptr, &err);
+        return err;
+    };
+    err = create(inputFlags, buffers.d_A);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create buffer d_A." << std::endl; return false; }
+    err = create(inputFlags, buffers.d_B);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create buffer d_B." << std::endl; return false; }
+    err = create(outputFlags, buffers.d_C);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create buffer d_C." << std::endl; return false; }
+    return true;
+}
+
+// Creates the A/B/C storage for the strategy; USE_HOST_PTR buffers wrap the given host vectors.
+// Device-allocated buffers come from `pool` when it is not null.
+bool create_pipeline_buffers(const cl::Context& context, BufferStrategy strategy, size_t bytes,
+                             HostVector& h_A, HostVector& h_B, HostVector& h_C, PipelineBuffers& buffers,
+                             BufferPool* pool) {
+    cl_int err = CL_SUCCESS;
+    buffers.strategy = strategy;
+    buffers.context = context;
+
+    // CL_MEM_READ_ONLY / CL_MEM_WRITE_ONLY: Hints for memory access patterns
+    // CL_MEM_HOST_WRITE_ONLY / CL_MEM_HOST_READ_ONLY: Hints for host access patterns
+    switch (strategy) {
+    case BufferStrategy::Copy:
+        return create_device_buffers(context, CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY,
+                                     CL_MEM_WRITE_ONLY | CL_MEM_HOST_READ_ONLY, bytes, pool, buffers);
+    case BufferStrategy::UseHostPtr:
+        buffers.d_A = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, bytes, h_A.data(), &err);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create buffer d_A." << std::endl; return false; }
+        buffers.d_B = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, bytes, h_B.data(), &err);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create buffer d_B." << std::endl; return false; }
+        buffers.d_C = cl::Buffer(context, CL_MEM_WRITE_ONLY | CL_MEM_USE_HOST_PTR, bytes, h_C.data(), &err);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create buffer d_C." << std::endl; return false; }
+        return true;
+    case BufferStrategy::AllocHostPtr:
+        return create_device_buffers(context, CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR | CL_MEM_HOST_WRITE_ONLY,
+                                     CL_MEM_WRITE_ONLY | CL_MEM_ALLOC_HOST_PTR | CL_MEM_HOST_READ_ONLY, bytes, pool, buffers);
+    case BufferStrategy::Svm:
+        buffers.svmA = static_cast<int*>(clSVMAlloc(context(), CL_MEM_READ_ONLY, bytes, 0));
+        buffers.svmB = static_cast<int*>(clSVMAlloc(context(), CL_MEM_READ_ONLY, bytes, 0));
+        buffers.svmC = static_cast<int*>(clSVMAlloc(context(), CL_MEM_WRITE_ONLY, bytes, 0));
+        if (!buffers.svmA || !buffers.svmB || !buffers.svmC) {
+            std::cerr << "Failed to allocate SVM buffers." << std::endl;
+            return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+// A std::chrono::steady_clock time in nanoseconds; the current time by default
+static double steady_ns(std::chrono::steady_clock::time_point time = std::chrono::steady_clock::now()) {
+    return std::chrono::duration<double, std::nano>(time.time_since_epoch()).count();
+}
+
+// Maps device profiling timestamps onto std::chrono::steady_clock: steady_ns = device_ns + offsetNs
+struct ClockAlignment {
+    bool available = false;
+    double offsetNs = 0.0;
+};
+
+// Whether the device's driver implements the OpenCL 2.1 timer queries. Headers declaring them
+// do not mean the ICD dispatches them: 1.x drivers have no entry, and 2.1+ platforms without a
+// host timer report a resolution of 0.
+static bool host_timer_supported(const cl::Device& device) {
+    std::string version;
+    device.getInfo(CL_DEVICE_VERSION, &version); // "OpenCL <major>.<minor> ..."
+    int major = 0, minor = 0;
+    if (std::sscanf(version.c_str(), "OpenCL %d.%d", &major, &minor) != 2) return false;
+    if (major < 2 || (major == 2 && minor < 1)) return false;
+#ifdef CL_PLATFORM_HOST_TIMER_RESOLUTION
+    cl_platform_id platformId = nullptr;
+    if (device.getInfo(CL_DEVICE_PLATFORM, &platformId) != CL_SUCCESS) return false;
+    cl_ulong resolution = 0;
+    if (cl::Platform(platformId, true).getInfo(CL_PLATFORM_HOST_TIMER_RESOLUTION, &resolution) != CL_SUCCESS) return false;
+    return resolution != 0;
+#else
+    return false;
+#endif
+}
+
+// Aligns the device timer with steady_clock through clGetDeviceAndHostTimer (OpenCL 2.1+).
+// clGetHostTimer is bracketed by two steady_clock reads to relate the implementation's host clock
+// to steady_clock; the tightest of a few tries wins.
+static ClockAlignment align_device_clock(const cl::Device& device) {
+    ClockAlignment alignment;
+#ifdef CL_VERSION_2_1
+    if (!host_timer_supported(device)) return alignment;
+    double bestWindow = 0.0;
+    for (int attempt = 0; attempt < 5; ++attempt) {
+        cl_ulong hostTimer = 0, deviceTime = 0, hostTime = 0;
+        double before = steady_ns();
+        if (clGetHostTimer(device(), &hostTimer) != CL_SUCCESS) return alignment;
+        double after = steady_ns();
+        if (clGetDeviceAndHostTimer(device(), &deviceTime, &hostTime) != CL_SUCCESS) return alignment;
+        double hostToSteady = (before + after) / 2.0 - (double)hostTimer;
+        if (!alignment.available || after - before < bestWindow) {
+            bestWindow = after - before;
+            alignment.offsetNs = (double)hostTime + hostToSteady - (double)deviceTime;
+            alignment.available = true;
+        }
+    }
+#else
+    (void)device;
+#endif
+    return alignment;
+}
+
+// Everything run_benchmark keeps for one device over the whole run: the context, the profiling
+// queue, every program built so far and the buffer pool, plus what setting them up cost. The
+// pipeline, size sweep, roofline, device-copy, type matrix and specialization paths draw their
+// device buffers from the pool. Local-size tuning and the pinned, streaming, launch-overhead,
+// batched-submission, concurrency, out-of-core, file I/O, access-pattern and reduction modes
+// allocate their own. The streaming, batched-submission, concurrency and out-of-core modes also
+// create their own extra queues
+struct DeviceSession {
+    cl::Device device;
+    cl::Context context;
+    cl::CommandQueue queue;
+    std::map<std::string, cl::Program> programs; // Keyed by build options + source
+    BufferPool pool;
+    ClockAlignment clock; // Device timer alignment, measured once when the session opens
+    double setupMs = 0.0; // Context + queue creation
+};
+
+// Creates the context and profiling queue of a session
+bool open_session(const cl::Device& device, DeviceSession& session) {
+    cl_int err;
+    auto start = std::chrono::steady_clock::now();
+    session.device = device;
+    session.context = cl::Context(device, nullptr, nullptr, nullptr, &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create context." << std::endl; return false; }
+    // Enable profiling on the command queue to measure execution times
+    session.queue = cl::CommandQueue(session.context, device, CL_QUEUE_PROFILING_ENABLE, &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create command queue." << std::endl; return false; }
+    session.pool.context = session.context;
+    session.clock = align_device_clock(device);
+    session.setupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+// Returns the session's program for source + buildOptions, building it (through the binary cache)
+// only the first time; `stats` stays empty when the program was already built
+bool session_program(DeviceSession& session, const std::string& source, const std::string& buildOptions,
+                     const BenchmarkOptions& options, cl::Program& program, BuildStats& stats) {
+    std::string key = buildOptions + '\n' + source;
+    auto found = session.programs.find(key);
+    if (found != session.programs.end()) {
+        program = found->second;
+        return true;
+    }
+    if (!build_program(session.context, session.device, source, buildOptions, options, program, stats)) return false;
+    session.programs[key] = program;
+    return true;
+}
+
+// Releases everything the session holds and returns how long that took in ms
+double close_session(DeviceSession& session) {
+    auto start = std::chrono::steady_clock::now();
+    session.queue.finish();
+    session.pool.free.clear();
+    session.pool.context = cl::Context();
+    session.programs.clear();
+    session.queue = cl::CommandQueue();
+    session.context = cl::Context();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Reports the fixed costs of a session, kept apart from the measured phases
+void print_session_stats(const DeviceSession& session, double teardownMs) {
+    std::cout << "\n--- Session Overhead ---" << std::endl;
+    std::cout << "Setup (context + queue):  " << session.setupMs << " ms" << std::endl;
+    std::cout << "Programs built:           " << session.programs.size() << std::endl;
+    std::cout << "Buffer pool:              " << session.pool.allocations << " buffers allocated in "
+              << session.pool.allocationMs << " ms, " << session.pool.reuses << " reuses" << std::endl;
+    std::cout << "Teardown:                 " << teardownMs << " ms" << std::endl;
+}
+
+// Sums the profiled durations of the commands making up one phase (e.g. map + unmap)
+static double phase_ms(const std::vector<cl::Event>& events) {
+    double ms = 0.0;
+    for (const auto& event : events) ms += event_ms(event);
+    return ms;
+}
+
+// Device-side extent of a set of profiled commands: the first START, the last END and the time
+// the device was busy with at least one of them (overlapping intervals are merged)
+struct DeviceSpan {
+    double firstStartNs = 0.0;
+    double lastEndNs = 0.0;
+    double busyNs = 0.0;
+};
+
+static DeviceSpan device_span(const std::vector<cl::Event>& events) {
+    std::vector<std::pair<double, double>> intervals;
+    for (const auto& event : events) {
+        cl_ulong start = 0, end = 0;
+        event.getProfilingInfo(CL_PROFILING_COMMAND_START, &start);
+        event.getProfilingInfo(CL_PROFILING_COMMAND_END, &end);
+        intervals.push_back({(double)start, (double)end});
+    }
+    DeviceSpan span;
+    if (intervals.empty()) return span;
+    std::sort(intervals.begin(), intervals.end());
+    span.firstStartNs = intervals.front().first;
+    double runStart = intervals.front().first, runEnd = intervals.front().second;
+    for (const auto& interval : intervals) {
+        if (interval.first > runEnd) {
+            span.busyNs += runEnd - runStart;
+            runStart = interval.first;
+        }
+        runEnd = std::max(runEnd, interval.second);
+    }
+    span.busyNs += runEnd - runStart;
+    span.lastEndNs = runEnd;
+    return span;
+}
+
+// One slice of the --trace timeline. Device commands keep their QUEUED and SUBMIT times so the
+// wait before START can be drawn next to the execution; host spans have all four equal.
+struct TraceSpan {
+    int pid = 0;   // One process per device
+    int tid = 0;   // One thread per command queue; 0 holds the host API spans
+    std::string name;
+    bool device = false;
+    double queuedNs = 0.0; // steady_clock nanoseconds
+    double submitNs = 0.0;
+    double startNs = 0.0;
+    double endNs = 0.0;
+};
+
+// Track of a registered command queue and the alignment of its device's timer
+struct TraceQueue {
+    int pid = 0;
+    int tid = 0;
+    ClockAlignment alignment;
+};
+
+// Everything recorded for --trace; written as Chrome trace JSON at exit
+struct TraceLog {
+    std::mutex mutex; // Multi-device workers record from their own threads
+    std::vector<std::pair<cl_device_id, std::string>> processes; // pid = index + 1
+    std::map<std::pair<int, int>, std::string> threads;          // (pid, tid) -> track name
+    std::map<cl_command_queue, TraceQueue> queues;
+    std::map<cl_device_id, ClockAlignment> clocks;               // Measured once per device
+    std::vector<TraceSpan> spans;
+};
+
+// A profiled command to add to the trace with trace_commands
+struct TraceCommand {
+    const cl::CommandQueue* queue;
+    std::string name;
+    cl::Event event;
+};
+
+// Gives `queue` a track named `label` in its device's process. Registering a new queue under an
+// existing label reuses the track, so recreated queues stay on one line. The device's timer
+// alignment is `clock` when the caller already has it (a session's), otherwise measured once per device.
+void trace_queue(TraceLog* trace, const cl::Device& device, const cl::CommandQueue& queue, const std::string& label,
+                 const ClockAlignment* clock = nullptr) {
+    if (!trace) return;
+    std::string deviceName;
+    device.getInfo(CL_DEVICE_NAME, &deviceName);
+
+    std::lock_guard<std::mutex> lock(trace->mutex);
+    auto known = trace->clocks.find(device());
+    if (clock) {
+        trace->clocks[device()] = *clock;
+    } else if (known == trace->clocks.end()) {
+        trace->clocks[device()] = align_device_clock(device);
+    }
+    ClockAlignment alignment = trace->clocks[device()];
+    int pid = 0;
+    for (size_t i = 0; i < trace->processes.size(); ++i) {
+        if (trace->processes[i].first == device()) pid = (int)i + 1;
+    }
+    if (pid == 0) {
+        trace->processes.push_back({device(), deviceName});
+        pid = (int)trace->processes.size();
+        trace->threads[{pid, 0}] = "host API";
+    }
+    int tid = 0, nextTid = 1;
+    for (const auto& thread : trace->threads) {
+        if (thread.first.first != pid) continue;
+        if (thread.first.second != 0 && thread.second == label) tid = thread.first.second;
+        nextTid = std::max(nextTid, thread.first.second + 1);
+    }
+    if (tid == 0) {
+        tid = nextTid;
+        trace->threads[{pid, tid}] = label;
+    }
+    trace->queues[queue()] = {pid, tid, alignment};
+}
+
+// Adds a host API span, in steady_ns() time, to the host track of the queue's device
+void trace_host_span(TraceLog* trace, const cl::CommandQueue& queue, const std::string& name, double startNs, double endNs) {
+    if (!trace) return;
+    std::lock_guard<std::mutex> lock(trace->mutex);
+    auto it = trace->queues.find(queue());
+    if (it == trace->queues.end()) return;
+    TraceSpan span;
+    span.pid = it->second.pid;
+    span.name = name;
+    span.queuedNs = span.submitNs = span.startNs = startNs;
+    span.endNs = endNs;
+    trace->spans.push_back(span);
+}
+
+// Adds completed, profiled commands to their queues' tracks. Without an aligned device timer the
+// last END is pinned to `hostDoneNs`, the moment the host saw the commands complete.
+void trace_commands(TraceLog* trace, const std::vector<TraceCommand>& commands, double hostDoneNs) {
+    if (!trace || commands.empty()) return;
+    std::vector<std::array<cl_ulong, 4>> times;
+    double lastEndNs = 0.0;
+    for (const auto& command : commands) {
+        std::array<cl_ulong, 4> t = {};
+        command.event.getProfilingInfo(CL_PROFILING_COMMAND_QUEUED, &t[0]);
+        command.event.getProfilingInfo(CL_PROFILING_COMMAND_SUBMIT, &t[1]);
+        command.event.getProfilingInfo(CL_PROFILING_COMMAND_START, &t[2]);
+        command.event.getProfilingInfo(CL_PROFILING_COMMAND_END, &t[3]);
+        lastEndNs = std::max(lastEndNs, (double)t[3]);
+        times.push_back(t);
+    }
+
+    std::lock_guard<std::mutex> lock(trace->mutex);
+    for (size_t i = 0; i < commands.size(); ++i) {
+        auto it = trace->queues.find((*commands[i].queue)());
+        if (it == trace->queues.end()) continue;
+        const ClockAlignment& alignment = it->second.alignment;
+        double offsetNs = alignment.available ? alignment.offsetNs : hostDoneNs - lastEndNs;
+        TraceSpan span;
+        span.pid = it->second.pid;
+        span.tid = it->second.tid;
+        span.name = commands[i].name;
+        span.device = true;
+        span.queuedNs = (double)times[i][0] + offsetNs;
+        span.submitNs = (double)times[i][1] + offsetNs;
+        span.startNs = (double)times[i][2] + offsetNs;
+        span.endNs = (double)times[i][3] + offsetNs;
+        trace->spans.push_back(span);
+    }
+}
+
+// Makes the host data visible to the device. Copy enqueues a non-blocking write; the mapped
+// strategies map for writing, fill the mapping on the host and unmap. The last event in
+// `events` completes when the data is ready for the kernel.
+static bool upload(const cl::CommandQueue& queue, const PipelineBuffers& buffers, const cl::Buffer& buffer,
+                   int* svmPtr, const HostVector& host, size_t bytes, std::vector<cl::Event>& events) {
+    cl_int err = CL_SUCCESS;
+    cl::Event mapEvent, doneEvent;
+
+    if (buffers.strategy == BufferStrategy::Copy) {
+        err = queue.enqueueWriteBuffer(buffer, CL_FALSE, 0, bytes, host.data(), nullptr, &doneEvent);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to write buffer." << std::endl; return false; }
+        events.push_back(doneEvent);
+        return true;
+    }
+
+    void* mapped = nullptr;
+    if (buffers.strategy == BufferStrategy::Svm) {
+        err = queue.enqueueMapSVM(svmPtr, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, bytes, nullptr, &mapEvent);
+        mapped = svmPtr;
+    } else {
+        mapped = queue.enqueueMapBuffer(buffer, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, 0, bytes, nullptr, &mapEvent, &err);
+    }
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to map buffer for writing." << std::endl; return false; }
+
+    // USE_HOST_PTR maps return the host vector itself, so there is nothing to copy
+    if (mapped != host.data()) std::memcpy(mapped, host.data(), bytes);
+
+    if (buffers.strategy == BufferStrategy::Svm) {
+        err = queue.enqueueUnmapSVM(svmPtr, nullptr, &doneEvent);
+    } else {
+        err = queue.enqueueUnmapMemObject(buffer, mapped, nullptr, &doneEvent);
+    }
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to unmap buffer." << std::endl; return false; }
+    events.push_back(mapEvent);
+    events.push_back(doneEvent);
+    return true;
+}
+
+// Brings the device result back into host memory once `dependencies` complete (blocking)
+static bool download(const cl::CommandQueue& queue, const PipelineBuffers& buffers, const cl::Buffer& buffer,
+                     int* svmPtr, HostVector& host, size_t bytes, const std::vector<cl::Event>& dependencies,
+                     std::vector<cl::Event>& events) {
+    cl_int err = CL_SUCCESS;
+    cl::Event mapEvent, doneEvent;
+
+    if (buffers.strategy == BufferStrategy::Copy) {
+        err = queue.enqueueReadBuffer(buffer, CL_TRUE, 0, bytes, host.data(), &dependencies, &doneEvent);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to read buffer." << std::endl; return false; }
+        events.push_back(doneEvent);
+        return true;
+    }
+
+    void* mapped = nullptr;
+    if (buffers.strategy == BufferStrategy::Svm) {
+        err = queue.enqueueMapSVM(svmPtr, CL_TRUE, CL_MAP_READ, bytes, &dependencies, &mapEvent);
+        mapped = svmPtr;
+    } else {
+        mapped = queue.enqueueMapBuffer(buffer, CL_TRUE, CL_MAP_READ, 0, bytes, &dependencies, &mapEvent, &err);
+    }
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to map buffer for reading." << std::endl; return false; }
+
+    if (mapped != host.data()) std::memcpy(host.data(), mapped, bytes);
+
+    if (buffers.strategy == BufferStrategy::Svm) {
+        err = queue.enqueueUnmapSVM(svmPtr, nullptr, &doneEvent);
+    } else {
+        err = queue.enqueueUnmapMemObject(buffer, mapped, nullptr, &doneEvent);
+    }
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to unmap buffer." << std::endl; return false; }
+    events.push_back(mapEvent);
+    events.push_back(doneEvent);
+    return true;
+}
+
+// Overwrites C on the device (and the host copy where it is separate) with VERIFY_POISON, so a
+// kernel that skips elements cannot be hidden by results left over from an earlier pass
+static bool poison_result(const cl::CommandQueue& queue, const PipelineBuffers& buffers, HostVector& h_C, size_t bytes) {
+    cl_int err;
+    if (buffers.strategy == BufferStrategy::Svm) {
+        err = clEnqueueSVMMemFill(queue(), buffers.svmC, &VERIFY_POISON, sizeof(int), bytes, 0, nullptr, nullptr);
+    } else {
+        err = queue.enqueueFillBuffer(buffers.d_C, VERIFY_POISON, 0, bytes);
+    }
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to poison result buffer." << std::endl; return false; }
+    err = queue.finish();
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to poison result buffer." << std::endl; return false; }
+    // USE_HOST_PTR's h_C is the buffer's own backing store and was covered by the fill
+    if (buffers.strategy != BufferStrategy::UseHostPtr) std::fill(h_C.begin(), h_C.end(), VERIFY_POISON);
+    return true;
+}
+
+// Sums C on the device with checksum_partials and adds the per-group partials on the host
+static bool device_checksum(const cl::Device& device, const cl::Context& context, const cl::CommandQueue& queue,
+                            const cl::Program& program, const PipelineBuffers& buffers, int dataSize, long long& sum) {
+    cl_int err;
+    cl::Kernel kernel(program, "checksum_partials", &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create kernel 'checksum_partials'." << std::endl; return false; }
+
+    // Largest power-of-two group size the kernel allows, capped at 256
+    size_t maxGroup = 1, groupSize = 1;
+    kernel.getWorkGroupInfo(device, CL_KERNEL_WORK_GROUP_SIZE, &maxGroup);
+    while (groupSize * 2 <= std::min<size_t>(maxGroup, 256)) groupSize *= 2;
+    cl_uint computeUnits = 1;
+    device.getInfo(CL_DEVICE_MAX_COMPUTE_UNITS, &computeUnits);
+    size_t groups = (size_t)computeUnits * GRID_STRIDE_GROUPS_PER_CU;
+
+    cl::Buffer d_partials(context, CL_MEM_WRITE_ONLY | CL_MEM_HOST_READ_ONLY, groups * sizeof(cl_long), nullptr, &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create checksum buffer." << std::endl; return false; }
+    if (buffers.strategy == BufferStrategy::Svm) {
+        kernel.setArgSVMPointer(0, buffers.svmC);
+    } else {
+        kernel.setArg(0, buffers.d_C);
+    }
+    kernel.setArg(1, d_partials);
+    kernel.setArg(2, cl::Local(groupSize * sizeof(cl_long)));
+    kernel.setArg(3, dataSize);
+
+    err = queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(groups * groupSize), cl::NDRange(groupSize));
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to enqueue kernel 'checksum_partials'." << std::endl; return false; }
+    std::vector<cl_long> partials(groups);
+    err = queue.enqueueReadBuffer(d_partials, CL_TRUE, 0, groups * sizeof(cl_long), partials.data());
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to read checksum buffer." << std::endl; return false; }
+
+    sum = 0;
+    for (cl_long partial : partials) sum += partial;
+    return true;
+}
+
+// Resolves KernelVariant::PreferredVector to the int vector width the device prefers
+KernelVariant resolve_variant(const cl::Device& device, KernelVariant variant) {
+    if (variant != KernelVariant::PreferredVector) return variant;
+    cl_uint width = 1;
+    device.getInfo(CL_DEVICE_PREFERRED_VECTOR_WIDTH_INT, &width);
+    if (width >= 16) return KernelVariant::Int16;
+    if (width >= 8) return KernelVariant::Int8;
+    if (width >= 4) return KernelVariant::Int4;
+    return KernelVariant::Scalar;
+}
+
+// Computes the NDRange a config is launched with for dataSize elements
+static void variant_launch_size(const cl::Device& device, const cl::Kernel& kernel, const PipelineConfig& config,
+                                int dataSize, cl::NDRange& global, cl::NDRange& local) {
+    if (config.variant == KernelVariant::GridStride) {
+        // A fixed grid of work-groups sized from the device, independent of dataSize
+        cl_uint computeUnits = 1;
+        size_t groupSize = config.localSize;
+        device.getInfo(CL_DEVICE_MAX_COMPUTE_UNITS, &computeUnits);
+        if (groupSize == 0) {
+            kernel.getWorkGroupInfo(device, CL_KERNEL_WORK_GROUP_SIZE, &groupSize);
+            groupSize = std::min<size_t>(groupSize, 256);
+        }
+        global = cl::NDRange((size_t)computeUnits * GRID_STRIDE_GROUPS_PER_CU * groupSize);
+        local = cl::NDRange(groupSize);
+        return;
+    }
+    int perItem = variant_elements_per_item(config.variant);
+    size_t items = ((size_t)dataSize + perItem - 1) / perItem;
+    if (config.localSize == 0) {
+        global = cl::NDRange(items);
+        // cl::NullRange lets OpenCL automatically choose a local work size.
+        local = cl::NullRange;
+        return;
+    }
+    // Round up to whole work-groups; every variant bounds-checks against N
+    global = cl::NDRange((items + config.localSize - 1) / config.localSize * config.localSize);
+    local = cl::NDRange(config.localSize);
+}
+
+// Runs options.warmupIterations untimed and options.iterations timed write A/B -> vecadd -> read C
+// passes over dataSize elements, reusing the same host vectors and device buffers for every pass.
+// For the mapped strategies a transfer phase is the device time of its map + unmap commands; the
+// host-side copy into or out of the mapping only shows up in the overall time.
+bool run_pipeline(const cl::Device& device, const cl::Context& context, const cl::CommandQueue& queue,
+                  const cl::Program& program, BufferPool* pool, TraceLog* trace, const ClockAlignment& alignment,
+                  int dataSize, const PipelineConfig& config, const BenchmarkOptions& options, PipelineResult& result) {
+    cl_int err;
+    size_t bytes = sizeof(int) * dataSize;
+    BufferStrategy strategy = config.strategy;
+
+    // --- 3. Prepare Host Data ---
+    HostVector h_A(dataSize, 1);
+    HostVector h_B(dataSize, 2);
+    HostVector h_C(dataSize); // Result vector
+
+    // --- 4. Create Device Buffers ---
+    PipelineBuffers buffers;
+    if (!create_pipeline_buffers(context, strategy, bytes, h_A, h_B, h_C, buffers, pool)) return false;
+
+    // --- 5. Create Kernel Object and Set Arguments ---
+    const char* kernelName = variant_kernel_name(config.variant);
+    cl::Kernel kernel(program, kernelName, &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create kernel '" << kernelName << "'." << std::endl; return false; }
+    if (strategy == BufferStrategy::Svm) {
+        kernel.setArgSVMPointer(0, buffers.svmA);
+        kernel.setArgSVMPointer(1, buffers.svmB);
+        kernel.setArgSVMPointer(2, buffers.svmC);
+    } else {
+        kernel.setArg(0, buffers.d_A);
+        kernel.setArg(1, buffers.d_B);
+        kernel.setArg(2, buffers.d_C);
+    }
+    kernel.setArg(3, dataSize);
+
+    cl::NDRange globalWorkSize, localWorkSize;
+    variant_launch_size(device, kernel, config, dataSize, globalWorkSize, localWorkSize);
+
+    // --- 6. Perform Benchmark Operations ---
+    std::vector<double> writeASamples, writeBSamples, kernelSamples, readCSamples, overallSamples;
+    std::vector<double> uploadCallSamples, kernelCallSamples, downloadCallSamples, finishCallSamples;
+    std::vector<double> busySamples, overheadSamples, submitSamples, gapSamples, tailSamples;
+    int totalIterations = options.warmupIterations + options.iterations;
+    for (int iter = 0; iter < totalIterations; ++iter) {
+        std::vector<cl::Event> writeEventsA, writeEventsB, readEventsC;
+        cl::Event kernelEvent;
+
+        // The last pass is the one verified; poison C first, outside the timed window
+        if (iter == totalIterations - 1 && !poison_result(queue, buffers, h_C, bytes)) return false;
+
+        // Each host API call is bracketed on the steady clock to split the overall time into
+        // call cost and waiting
+        // Data transfer: Host to Device (non-blocking for copy)
+        auto start_overall = std::chrono::steady_clock::now();
+        double startNs = steady_ns();
+        if (!upload(queue, buffers, buffers.d_A, buffers.svmA, h_A, bytes, writeEventsA)) return false;
+        if (!upload(queue, buffers, buffers.d_B, buffers.svmB, h_B, bytes, writeEventsB)) return false;
+        double uploadedNs = steady_ns();
+
+        // Enqueue Kernel (waits for write events to complete)
+        std::vector<cl::Event> writeEvents = {writeEventsA.back(), writeEventsB.back()};
+        err = queue.enqueueNDRangeKernel(kernel, cl::NullRange, globalWorkSize, localWorkSize, &writeEvents, &kernelEvent);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to enqueue kernel '" << kernelName << "'." << std::endl; return false; }
+        double enqueuedNs = steady_ns();
+
+        // Data transfer: Device to Host (blocking, waits for kernel completion)
+        std::vector<cl::Event> kernelDependencies = {kernelEvent};
+        if (!download(queue, buffers, buffers.d_C, buffers.svmC, h_C, bytes, kernelDependencies, readEventsC)) return false;
+        double downloadedNs = steady_ns();
+
+        // Finish all commands in the queue to ensure profiling data is available
+        queue.finish();
+        double finishedNs = steady_ns();
+
+        auto end_overall = std::chrono::steady_clock::now();
+        std::chrono::duration<double, std::milli> overall_ms = end_overall - start_overall;
+
+        if (trace) {
+            trace_host_span(trace, queue, "upload A, B", startNs, uploadedNs);
+            trace_host_span(trace, queue, std::string("enqueue ") + kernelName, uploadedNs, enqueuedNs);
+            trace_host_span(trace, queue, "download C", enqueuedNs, downloadedNs);
+            trace_host_span(trace, queue, "finish", downloadedNs, finishedNs);
+            std::vector<TraceCommand> commands;
+            for (const auto& event : writeEventsA) commands.push_back({&queue, "write A", event});
+            for (const auto& event : writeEventsB) commands.push_back({&queue, "write B", event});
+            commands.push_back({&queue, kernelName, kernelEvent});
+            for (const auto& event : readEventsC) commands.push_back({&queue, "read C", event});
+            trace_commands(trace, commands, finishedNs);
+        }
+
+        // Warmup passes absorb first-touch, JIT and page-pinning costs and are not recorded
+        if (iter < options.warmupIterations) continue;
+
+        // --- 7. Get Profiling Info ---
+        writeASamples.push_back(phase_ms(writeEventsA));
+        writeBSamples.push_back(phase_ms(writeEventsB));
+        kernelSamples.push_back(event_ms(kernelEvent));
+        readCSamples.push_back(phase_ms(readEventsC));
+        overallSamples.push_back(overall_ms.count());
+
+        uploadCallSamples.push_back((uploadedNs - startNs) * 1e-6);
+        kernelCallSamples.push_back((enqueuedNs - uploadedNs) * 1e-6);
+        downloadCallSamples.push_back((downloadedNs - enqueuedNs) * 1e-6);
+        finishCallSamples.push_back((finishedNs - downloadedNs) * 1e-6);
+        std::vector<cl::Event> allEvents = writeEventsA;
+        allEvents.insert(allEvents.end(), writeEventsB.begin(), writeEventsB.end());
+        allEvents.push_back(kernelEvent);
+        allEvents.insert(allEvents.end(), readEventsC.begin(), readEventsC.end());
+        DeviceSpan span = device_span(allEvents);
+        busySamples.push_back(span.busyNs * 1e-6);
+        overheadSamples.push_back(std::max(0.0, overall_ms.count() - span.busyNs * 1e-6));
+        if (alignment.available) {
+            submitSamples.push_back((span.firstStartNs + alignment.offsetNs - startNs) * 1e-6);
+            gapSamples.push_back((span.lastEndNs - span.firstStartNs - span.busyNs) * 1e-6);
+            tailSamples.push_back((finishedNs - (span.lastEndNs + alignment.offsetNs)) * 1e-6);
+        }
+    }
+
+    result.elements = dataSize;
+    result.config = config;
+    result.writeA = compute_stats(writeASamples);
+    result.writeB = compute_stats(writeBSamples);
+    result.kernel = compute_stats(kernelSamples);
+    result.readC = compute_stats(readCSamples);
+    result.overall = compute_stats(overallSamples);
+    result.uploadCalls = compute_stats(uploadCallSamples);
+    result.kernelCall = compute_stats(kernelCallSamples);
+    result.downloadCall = compute_stats(downloadCallSamples);
+    result.finishCall = compute_stats(finishCallSamples);
+    result.deviceBusy = compute_stats(busySamples);
+    result.overhead = compute_stats(overheadSamples);
+    result.aligned = alignment.available;
+    result.submitLatency = compute_stats(submitSamples);
+    result.deviceGaps = compute_stats(gapSamples);
+    result.tailLatency = compute_stats(tailSamples);
+
+    // --- 8. Verify Results (after the timed passes) ---
+    if (options.verifyMode == VerifyMode::Checksum) {
+        result.verify.viaChecksum = true;
+        result.verify.checked = dataSize;
+        result.verify.hostSum = host_checksum(h_A.data(), h_B.data(), dataSize);
+        if (!device_checksum(device, context, queue, program, buffers, dataSize, result.verify.deviceSum)) return false;
+        result.verify.correct = result.verify.deviceSum == result.verify.hostSum;
+        if (result.verify.correct) return true;
+        // A checksum cannot say where the result is wrong, so fall back to the full compare to locate
+        // it; that compare is authoritative if it finds nothing
+    }
+    VerifyResult full = verify_vecadd(h_A.data(), h_B.data(), h_C.data(), dataSize);
+    full.viaChecksum = result.verify.viaChecksum;
+    full.deviceSum = result.verify.deviceSum;
+    full.hostSum = result.verify.hostSum;
+    result.verify = full;
+    return true;
+}
+
+// Theoretical peak bandwidths used to put measured GB/s into perspective (0 = unknown)
+struct DevicePeaks {
+    double memoryGBps = 0.0;  // Device global memory, bounds the kernel
+    double linkGBps = 0.0;    // Host <-> device link, bounds Write A/B and Read C
+    std::string memorySource; // Where each figure came from, for the report
+    std::string linkSource;
+};
+
+// Reads the first line of a sysfs attribute, or returns an empty string
+static std::string read_sysfs(const std::string& path) {
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+// PCI address of the device ("dddd:bb:dd.f") from cl_khr_pci_bus_info or, on NVIDIA drivers
+// without it, cl_nv_device_attribute_query; empty if the device reports neither
+static std::string device_pci_address(const cl::Device& device) {
+    std::string extensions;
+    device.getInfo(CL_DEVICE_EXTENSIONS, &extensions);
+    char address[32];
+#ifdef CL_DEVICE_PCI_BUS_INFO_KHR
+    if (extensions.find("cl_khr_pci_bus_info") != std::string::npos) {
+        cl_device_pci_bus_info_khr busInfo = {};
+        if (clGetDeviceInfo(device(), CL_DEVICE_PCI_BUS_INFO_KHR, sizeof(busInfo), &busInfo, nullptr) == CL_SUCCESS) {
+            std::snprintf(address, sizeof(address), "%04x:%02x:%02x.%x", busInfo.pci_domain, busInfo.pci_bus,
+                          busInfo.pci_device, busInfo.pci_function);
+            return address;
+        }
+    }
+#endif
+#ifdef CL_DEVICE_PCI_BUS_ID_NV
+    if (extensions.find("cl_nv_device_attribute_query") != std::string::npos) {
+        cl_uint bus = 0, slot = 0, domain = 0;
+        if (clGetDeviceInfo(device(), CL_DEVICE_PCI_BUS_ID_NV, sizeof(bus), &bus, nullptr) == CL_SUCCESS &&
+            clGetDeviceInfo(device(), CL_DEVICE_PCI_SLOT_ID_NV, sizeof(slot), &slot, nullptr) == CL_SUCCESS) {
+            // Older drivers lack the domain query; their GPUs are in domain 0
+            clGetDeviceInfo(device(), CL_DEVICE_PCI_DOMAIN_ID_NV, sizeof(domain), &domain, nullptr);
+            std::snprintf(address, sizeof(address), "%04x:%02x:%02x.%x", domain, bus, slot >> 3, slot & 7);
+            return address;
+        }
+    }
+#endif
+    (void)address;
+    return "";
+}
+
+// Estimates the PCIe link bandwidth of the device from its PCI address and Linux sysfs
+static double estimate_link_gbps(const cl::Device& device) {
+    std::string address = device_pci_address(device);
+    if (address.empty()) return 0.0;
+    std::string sysfs = "/sys/bus/pci/devices/" + address + "/";
+    // e.g. "16.0 GT/s PCIe" and "8"
+    double gigaTransfers = std::strtod(read_sysfs(sysfs + "current_link_speed").c_str(), nullptr);
+    int lanes = std::atoi(read_sysfs(sysfs + "current_link_width").c_str());
+    if (gigaTransfers <= 0.0 || lanes <= 0) return 0.0;
+
+    // PCIe 1.x/2.x use 8b/10b encoding, 3.0 and later 128b/130b
+    double encoding = gigaTransfers < 8.0 ? 8.0 / 10.0 : 128.0 / 130.0;
+    return gigaTransfers * encoding * lanes / 8.0;
+}
+
+// Looks up peak bandwidths from the user table first, then falls back to what the device exposes.
+// OpenCL has no query for memory bus width or memory clock, so the device-memory peak is only
+// known when the table provides it.
+DevicePeaks lookup_device_peaks(const cl::Device& device, const std::string& deviceName, const BenchmarkOptions& options) {
+    DevicePeaks peaks;
+    for (const auto& entry : options.peakTable) {
+        if (deviceName.find(entry.deviceMatch) == std::string::npos) continue;
+        if (entry.memoryGBps > 0.0) { peaks.memoryGBps = entry.memoryGBps; peaks.memorySource = "peak table"; }
+        if (entry.linkGBps > 0.0) { peaks.linkGBps = entry.linkGBps; peaks.linkSource = "peak table"; }
+        break;
+    }
+    if (peaks.linkGBps == 0.0) {
+        peaks.linkGBps = estimate_link_gbps(device);
+        if (peaks.linkGBps > 0.0) peaks.linkSource = "PCIe link";
+    }
+    return peaks;
+}
+
+// Formats "<rate> GB/s" plus the share of the peak when the peak is known
+static std::string format_rate(double gbps, double peakGBps) {
+    std::ostringstream out;
+    out << gbps << " GB/s";
+    if (peakGBps > 0.0) out << " (" << std::setprecision(3) << gbps / peakGBps * 100.0 << "% of peak)";
+    return out.str();
+}
+
+// Prints the peak bandwidths known for the device
+void print_device_peaks(const DevicePeaks& peaks) {
+    std::cout << "Theoretical peak: memory ";
+    if (peaks.memoryGBps > 0.0) std::cout << peaks.memoryGBps << " GB/s (" << peaks.memorySource << ")";
+    else std::cout << "unknown";
+    std::cout << ", host link ";
+    if (peaks.linkGBps > 0.0) std::cout << peaks.linkGBps << " GB/s (" << peaks.linkSource << ")";
+    else std::cout << "unknown";
+    std::cout << std::endl;
+}
+
+// Prints one row of the per-phase statistics table
+static void print_phase_stats(const std::string& label, const PhaseStats& stats) {
+    std::cout << std::left << std::setw(28) << label << std::right
+              << std::setw(11) << stats.min
+              << std::setw(11) << stats.median
+              << std::setw(11) << stats.p95
+              << std::setw(11) << stats.p99
+              << std::setw(11) << stats.stddev
+              << std::setw(9) << stats.cv * 100.0 << "%" << std::endl;
+}
+
+// Prints the results of the passes run over one problem size
+void print_pipeline_result(const PipelineResult& result, const DevicePeaks& peaks, const BenchmarkOptions& options) {
+    std::cout << "\n--- Benchmark Results (" << result.elements << " elements, " << strategy_name(result.config.strategy) << ", "
+              << variant_name(result.config.variant) << ", local "
+              << (result.config.localSize ? std::to_string(result.config.localSize) : std::string("auto")) << ", "
+              << options.iterations << " iterations after " << options.warmupIterations << " warmup) ---" << std::endl;
+    std::cout << "Data Size: " << result.elements * sizeof(int) / (1024.0 * 1024.0) << " MB" << std::endl;
+    std::cout << std::left << std::setw(28) << "Phase (ms)" << std::right
+              << std::setw(11) << "min"
+              << std::setw(11) << "median"
+              << std::setw(11) << "p95"
+              << std::setw(11) << "p99"
+              << std::setw(11) << "stddev"
+              << std::setw(10) << "cv" << std::endl;
+    print_phase_stats("Write A (Host -> Device):", result.writeA);
+    print_phase_stats("Write B (Host -> Device):", result.writeB);
+    print_phase_stats("Kernel Execution Time:", result.kernel);
+    print_phase_stats("Read C (Device -> Host):", result.readC);
+    print_phase_stats("Total Overall Time (host):", result.overall);
+
+    // Effective rates from the medians; vecadd moves 12 bytes and does one add per element
+    double bufferBytes = (double)result.elements * sizeof(int);
+    std::cout << "Write A bandwidth:        " << format_rate(gb_per_s(bufferBytes, result.writeA.median), peaks.linkGBps) << std::endl;
+    std::cout << "Write B bandwidth:        " << format_rate(gb_per_s(bufferBytes, result.writeB.median), peaks.linkGBps) << std::endl;
+    std::cout << "Kernel bandwidth:         " << format_rate(gb_per_s(3.0 * bufferBytes, result.kernel.median), peaks.memoryGBps)
+              << ", " << gb_per_s((double)result.elements, result.kernel.median) << " GOP/s" << std::endl;
+    std::cout << "Read C bandwidth:         " << format_rate(gb_per_s(bufferBytes, result.readC.median), peaks.linkGBps) << std::endl;
+
+    // A high coefficient of variation means the median cannot be trusted to detect regressions
+    const std::pair<const char*, const PhaseStats*> phases[] = {
+        {"Write A", &result.writeA}, {"Write B", &result.writeB}, {"Kernel", &result.kernel},
+        {"Read C", &result.readC}, {"Total Overall", &result.overall},
+    };
+    for (const auto& phase : phases) {
+        if (phase.second->cv > options.cvWarnThreshold) {
+            std::cout << "WARNING: " << phase.first << " varies by " << phase.second->cv * 100.0
+                      << "% (cv > " << options.cvWarnThreshold * 100.0 << "%); consider more iterations" << std::endl;
+        }
+    }
+
+    // Where the host time goes, and how much of it the device was actually busy
+    std::cout << "Host API calls (median):  upload " << result.uploadCalls.median << " ms, kernel enqueue "
+              << result.kernelCall.median << " ms, download " << result.downloadCall.median << " ms, finish "
+              << result.finishCall.median << " ms" << std::endl;
+    std::cout << "Device busy:              " << result.deviceBusy.median << " ms of " << result.overall.median
+              << " ms overall; unaccounted driver/scheduling overhead " << result.overhead.median << " ms ("
+              << (result.overall.median > 0.0 ? result.overhead.median / result.overall.median * 100.0 : 0.0)
+              << "%)" << std::endl;
+    if (result.aligned) {
+        std::cout << "Aligned timeline:         first enqueue -> device START " << result.submitLatency.median
+                  << " ms, device idle between commands " << result.deviceGaps.median
+                  << " ms, last END -> host return " << result.tailLatency.median << " ms" << std::endl;
+    } else {
+        std::cout << "Aligned timeline:         unavailable (needs clGetDeviceAndHostTimer, OpenCL 2.1+)" << std::endl;
+    }
+
+    std::cout << "Result verification: " << describe_verification(result.verify) << std::endl;
+}
+
+// Prints the median phase times of several buffer strategy / kernel variant combinations side by side
+void print_config_comparison(const std::vector<PipelineResult>& results) {
+    std::cout << "\n--- Configuration Comparison (median ms) ---" << std::endl;
+    std::cout << std::left << std::setw(16) << "Strategy" << std::setw(13) << "Kernel" << std::right
+              << std::setw(14) << "Write A+B"
+              << std::setw(14) << "Kernel"
+              << std::setw(14) << "Read C"
+              << std::setw(14) << "Overall"
+              << "  Verified" << std::endl;
+    for (const auto& result : results) {
+        std::cout << std::left << std::setw(16) << strategy_name(result.config.strategy)
+                  << std::setw(13) << variant_name(result.config.variant) << std::right
+                  << std::setw(14) << result.writeA.median + result.writeB.median
+                  << std::setw(14) << result.kernel.median
+                  << std::setw(14) << result.readC.median
+                  << std::setw(14) << result.overall.median
+                  << "  " << (result.verify.correct ? "PASSED" : "FAILED") << std::endl;
+    }
+}
+
+// Builds the geometric series of element counts covered by a sweep on this device
+std::vector<int> sweep_sizes(const cl::Device& device, const BenchmarkOptions& options) {
+    cl_ulong maxAlloc = 0;
+    device.getInfo(CL_DEVICE_MAX_MEM_ALLOC_SIZE, &maxAlloc);
+
+    size_t maxElements = (size_t)((double)maxAlloc * options.sweepMaxFraction) / sizeof(int);
+    if (maxElements > (size_t)INT_MAX) maxElements = INT_MAX; // vecadd takes N as an int
+    size_t minElements = options.sweepMinBytes / sizeof(int);
+    if (minElements == 0) minElements = 1;
+
+    std::vector<int> sizes;
+    for (double n = (double)minElements; n <= (double)maxElements; n *= options.sweepFactor) {
+        int elements = (int)n;
+        if (sizes.empty() || elements > sizes.back()) sizes.push_back(elements);
+    }
+    if (!sizes.empty() && (size_t)sizes.back() < maxElements) sizes.push_back((int)maxElements);
+    return sizes;
+}
+
+// Returns the index of the first sample reaching levelOffRatio of the best one, or -1 if none
+static int level_off_index(const std::vector<double>& rates, double levelOffRatio) {
+    double best = 0.0;
+    for (double rate : rates) best = rate > best ? rate : best;
+    if (best <= 0.0) return -1;
+    for (size_t i = 0; i < rates.size(); ++i) {
+        if (rates[i] >= best * levelOffRatio) return (int)i;
+    }
+    return -1;
+}
+
+// Tuned local work sizes keyed by "<platform>\t<device>\t<driver version>\t<kernel>"
+using TuningCache = std::map<std::string, size_t>;
+
+// Builds the cache key identifying a kernel on one platform / device / driver
+std::string tuning_key(const cl::Platform& platform, const cl::Device& device, const std::string& kernelName) {
+    std::string platformName, deviceName, driverVersion;
+    platform.getInfo(CL_PLATFORM_NAME, &platformName);
+    device.getInfo(CL_DEVICE_NAME, &deviceName);
+    device.getInfo(CL_DRIVER_VERSION, &driverVersion);
+    return platformName + "\t" + deviceName + "\t" + driverVersion + "\t" + kernelName;
+}
+
+// Loads "<key>\t<local size>" lines; a missing file is an empty cache
+TuningCache load_tuning_cache(const std::string& path) {
+    TuningCache cache;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t tab = line.rfind('\t');
+        if (tab == std::string::npos) continue;
+        size_t localSize = std::strtoull(line.c_str() + tab + 1, nullptr, 10);
+        if (localSize > 0) cache[line.substr(0, tab)] = localSize;
+    }
+    return cache;
+}
+
+// Rewrites the whole cache file
+bool save_tuning_cache(const std::string& path, const TuningCache& cache) {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        std::cerr << "Cannot write tuning cache: " << path << std::endl;
+        return false;
+    }
+    for (const auto& entry : cache) file << entry.first << "\t" << entry.second << "\n";
+    return true;
+}
+
+// Local sizes worth trying: every multiple of the preferred multiple up to 16x, then doubling, so
+// devices reporting a multiple of 1 and a limit of 4096 do not need thousands of candidates
+static std::vector<size_t> local_size_candidates(size_t multiple, size_t maxSize) {
+    std::vector<size_t> candidates;
+    if (multiple == 0) multiple = 1;
+    for (size_t size = multiple; size <= maxSize; ) {
+        candidates.push_back(size);
+        size = candidates.size() < 16 ? size + multiple : size * 2;
+    }
+    return candidates;
+}
+
+// Times only the kernel of the given config at DATA_SIZE; returns the median in ms or a negative value on error
+static double time_kernel(const cl::Device& device, const cl::CommandQueue& queue, cl::Kernel& kernel,
+                          const PipelineConfig& config, const BenchmarkOptions& options) {
+    cl::NDRange globalWorkSize, localWorkSize;
+    variant_launch_size(device, kernel, config, DATA_SIZE, globalWorkSize, localWorkSize);
+    std::vector<double> samples;
+    for (int iter = 0; iter < options.warmupIterations + options.iterations; ++iter) {
+        cl::Event kernelEvent;
+        cl_int err = queue.enqueueNDRangeKernel(kernel, cl::NullRange, globalWorkSize, localWorkSize, nullptr, &kernelEvent);
+        if (err != CL_SUCCESS) return -1.0;
+        kernelEvent.wait();
+        if (iter >= options.warmupIterations) samples.push_back(event_ms(kernelEvent));
+    }
+    return compute_stats(samples).median;
+}
+
+// Sweeps local sizes in multiples of CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE up to
+// CL_KERNEL_WORK_GROUP_SIZE for one variant and returns the fastest (0 if tuning failed)
+size_t autotune_local_size(const cl::Device& device, const cl::Context& context, const cl::CommandQueue& queue,
+                           const cl::Program& program, KernelVariant variant, const BenchmarkOptions& options) {
+    cl_int err;
+    size_t bytes = sizeof(int) * DATA_SIZE;
+    const char* kernelName = variant_kernel_name(variant);
+
+    std::vector<int> h_A(DATA_SIZE, 1), h_B(DATA_SIZE, 2);
+    cl::Buffer d_A(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, bytes, h_A.data(), &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create buffer d_A." << std::endl; return 0; }
+    cl::Buffer d_B(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, bytes, h_B.data(), &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create buffer d_B." << std::endl; return 0; }
+    cl::Buffer d_C(context, CL_MEM_WRITE_ONLY, bytes, nullptr, &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create buffer d_C." << std::endl; return 0; }
+    cl::Kernel kernel(program, kernelName, &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create kernel '" << kernelName << "'." << std::endl; return 0; }
+    kernel.setArg(0, d_A);
+    kernel.setArg(1, d_B);
+    kernel.setArg(2, d_C);
+    kernel.setArg(3, DATA_SIZE);
+
+    size_t multiple = 1, maxSize = 1;
+    kernel.getWorkGroupInfo(device, CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE, &multiple);
+    kernel.getWorkGroupInfo(device, CL_KERNEL_WORK_GROUP_SIZE, &maxSize);
+
+    PipelineConfig config;
+    config.variant = variant;
+    double driverMs = time_kernel(device, queue, kernel, config, options);
+
+    std::cout << "\n--- Local Size Autotune (" << kernelName << ", multiple " << multiple << ", max " << maxSize
+              << ", median of " << options.iterations << " iterations) ---" << std::endl;
+    std::cout << std::setw(12) << "Local size" << std::setw(14) << "Kernel (ms)" << std::setw(16) << "Kernel (GB/s)" << std::endl;
+    if (driverMs >= 0.0) {
+        std::cout << std::setw(12) << "driver" << std::setw(14) << driverMs
+                  << std::setw(16) << gb_per_s(3.0 * bytes, driverMs) << std::endl;
+    }
+
+    size_t bestSize = 0;
+    double bestMs = 0.0;
+    for (size_t localSize : local_size_candidates(multiple, maxSize)) {
+        config.localSize = localSize;
+        double ms = time_kernel(device, queue, kernel, config, options);
+        if (ms < 0.0) continue; // e.g. CL_INVALID_WORK_GROUP_SIZE on pre-2.0 devices
+        std::cout << std::setw(12) << localSize << std::setw(14) << ms << std::setw(16) << gb_per_s(3.0 * bytes, ms) << std::endl;
+        if (bestSize == 0 || ms < bestMs) {
+            bestSize = localSize;
+            bestMs = ms;
+        }
+    }
+    if (bestSize > 0) {
+        std::cout << "Best local size: " << bestSize << " (" << bestMs << " ms";
+        if (driverMs > 0.0) std::cout << ", " << driverMs / bestMs << "x vs driver choice";
+        std::cout << ")" << std::endl;
+    }
+    return bestSize;
+}
+
+// Runs the pipeline over a geometric series of sizes, reports where the rates level off and
+// returns the result of every size
+std::vector<PipelineResult> run_size_sweep(const cl::Device& device, const cl::Context& context, const cl::CommandQueue& queue,
+                                           const cl::Program& program, BufferPool* pool, TraceLog* trace,
+                                           const ClockAlignment& clock, const PipelineConfig& config,
+                                           const BenchmarkOptions& options) {
+    std::vector<int> sizes = sweep_sizes(device, options);
+    if (sizes.empty()) {
+        std::cerr << "Sweep range is empty for this device (check --sweep-min-kb and --sweep-max-fraction)." << std::endl;
+        return {};
+    }
+
+    std::vector<PipelineResult> results;
+    std::vector<double> transferRates, kernelRates;
+
+    std::cout << "\n--- Size Sweep Results (" << strategy_name(config.strategy) << ", "
+              << variant_name(config.variant) << ", " << sizes.size()
+              << " sizes, x" << options.sweepFactor << ", median of " << options.iterations << " iterations) ---" << std::endl;
+    std::cout << std::setw(14) << "Size (KB)"
+              << std::setw(18) << "Write A+B (GB/s)"
+              << std::setw(16) << "Kernel (GB/s)"
+              << std::setw(16) << "Read C (GB/s)"
+              << std::setw(16) << "Overall (ms)"
+              << "  Verified" << std::endl;
+
+    for (int elements : sizes) {
+        PipelineResult result;
+        if (!run_pipeline(device, context, queue, program, pool, trace, clock, elements, config, options, result)) {
+            std::cerr << "Stopping sweep at " << elements << " elements." << std::endl;
+            break;
+        }
+
+        double bufferBytes = (double)elements * sizeof(int);
+        double writeRate = gb_per_s(2.0 * bufferBytes, result.writeA.median + result.writeB.median);
+        double readRate = gb_per_s(bufferBytes, result.readC.median);
+        // vecadd reads A and B and writes C: 12 bytes per element
+        double kernelRate = gb_per_s(3.0 * bufferBytes, result.kernel.median);
+
+        std::cout << std::setw(14) << bufferBytes / 1024.0
+                  << std::setw(18) << writeRate
+                  << std::setw(16) << kernelRate
+                  << std::setw(16) << readRate
+                  << std::setw(16) << result.overall.median
+                  << "  " << (result.verify.correct ? "PASSED" : "FAILED") << std::endl;
+
+        results.push_back(result);
+        transferRates.push_back(gb_per_s(3.0 * bufferBytes,
+                                         result.writeA.median + result.writeB.median + result.readC.median));
+        kernelRates.push_back(kernelRate);
+    }
+
+    // The crossover is the smallest size where the rate gets within levelOffRatio of the best rate seen,
+    // i.e. where fixed launch/transfer overhead stops dominating.
+    int transferIdx = level_off_index(transferRates, options.levelOffRatio);
+    int kernelIdx = level_off_index(kernelRates, options.levelOffRatio);
+    if (transferIdx >= 0) {
+        std::cout << "Transfer bandwidth levels off at " << results[transferIdx].elements * sizeof(int) / 1024.0
+                  << " KB (" << transferRates[transferIdx] << " GB/s, "
+                  << options.levelOffRatio * 100.0 << "% of best)" << std::endl;
+    }
+    if (kernelIdx >= 0) {
+        std::cout << "Kernel throughput levels off at " << results[kernelIdx].elements * sizeof(int) / 1024.0
+                  << " KB (" << kernelRates[kernelIdx] << " GB/s, "
+                  << options.levelOffRatio * 100.0 << "% of best)" << std::endl;
+    }
+    return results;
+}
+
+// Host staging memory backed by a CL_MEM_ALLOC_HOST_PTR buffer that stays mapped for its lifetime,
+// which on discrete GPUs gives page-locked memory the DMA engine can read without a bounce buffer
+struct PinnedHostBuffer {
+    cl::CommandQueue queue;
+    cl::Buffer buffer;
+    int* ptr = nullptr;
+
+    PinnedHostBuffer() = default;
+    PinnedHostBuffer(const PinnedHostBuffer&) = delete;
+    PinnedHostBuffer& operator=(const PinnedHostBuffer&) = delete;
+    ~PinnedHostBuffer() {
+        if (ptr) {
+            queue.enqueueUnmapMemObject(buffer, ptr);
+            queue.finish();
+        }
+    }
+};
+
+// Allocates and maps `bytes` of pinned staging memory
+bool create_pinned_host_buffer(const cl::Context& context, const cl::CommandQueue& queue, size_t bytes,
+                               PinnedHostBuffer& pinned) {
+    cl_int err;
+    pinned.queue = queue;
+    pinned.buffer = cl::Buffer(context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, bytes, nullptr, &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create pinned staging buffer." << std::endl; return false; }
+    pinned.ptr = static_cast<int*>(queue.enqueueMapBuffer(pinned.buffer, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, bytes,
+                                                          nullptr, nullptr, &err));
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to map pinned staging buffer." << std::endl; return false; }
+    return true;
+}
+
+// Median H2D / D2H bandwidth (GB/s) between one host staging area and a device buffer
+struct HostTransferRates {
+    double h2d = 0.0;
+    double d2h = 0.0;
+};
+
+// Times warmup + measured enqueueWriteBuffer/enqueueReadBuffer pairs between `host` and `device`
+static bool measure_host_transfers(const cl::CommandQueue& queue, const cl::Buffer& deviceBuffer, int* host,
+                                   size_t bytes, const BenchmarkOptions& options, HostTransferRates& rates) {
+    cl_int err;
+    std::vector<double> writeSamples, readSamples;
+    for (int iter = 0; iter < options.warmupIterations + options.iterations; ++iter) {
+        cl::Event writeEvent, readEvent;
+        err = queue.enqueueWriteBuffer(deviceBuffer, CL_FALSE, 0, bytes, host, nullptr, &writeEvent);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to write device buffer." << std::endl; return false; }
+        err = queue.enqueueReadBuffer(deviceBuffer, CL_FALSE, 0, bytes, host, nullptr, &readEvent);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to read device buffer." << std::endl; return false; }
+        queue.finish();
+
+        if (iter < options.warmupIterations) continue;
+        writeSamples.push_back(event_ms(writeEvent));
+        readSamples.push_back(event_ms(readEvent));
+    }
+    rates.h2d = gb_per_s((double)bytes, compute_stats(writeSamples).median);
+    rates.d2h = gb_per_s((double)bytes, compute_stats(readSamples).median);
+    return true;
+}
+
+// Compares H2D/D2H bandwidth from a pageable std::vector against a pinned staging buffer
+void run_pinned_comparison(const cl::Device& device, const cl::Context& context, const cl::CommandQueue& queue,
+                           const BenchmarkOptions& options) {
+    std::vector<int> sizes = options.sweep ? sweep_sizes(device, options) : std::vector<int>{DATA_SIZE};
+
+    std::cout << "\n--- Pageable vs Pinned Host Memory (median GB/s of " << options.iterations << " iterations) ---" << std::endl;
+    std::cout << std::setw(14) << "Size (KB)"
+              << std::setw(16) << "Pageable H2D"
+              << std::setw(14) << "Pinned H2D"
+              << std::setw(16) << "Pageable D2H"
+              << std::setw(14) << "Pinned D2H"
+              << std::setw(14) << "H2D gain"
+              << std::setw(14) << "D2H gain" << std::endl;
+
+    for (int elements : sizes) {
+        cl_int err;
+        size_t bytes = sizeof(int) * elements;
+        cl::Buffer deviceBuffer(context, CL_MEM_READ_WRITE, bytes, nullptr, &err);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create device buffer." << std::endl; return; }
+
+        std::vector<int> pageable(elements, 1);
+        PinnedHostBuffer pinned;
+        if (!create_pinned_host_buffer(context, queue, bytes, pinned)) return;
+        std::fill(pinned.ptr, pinned.ptr + elements, 1);
+
+        HostTransferRates pageableRates, pinnedRates;
+        if (!measure_host_transfers(queue, deviceBuffer, pageable.data(), bytes, options, pageableRates)) return;
+        if (!measure_host_transfers(queue, deviceBuffer, pinned.ptr, bytes, options, pinnedRates)) return;
+
+        std::cout << std::setw(14) << bytes / 1024.0
+                  << std::setw(16) << pageableRates.h2d
+                  << std::setw(14) << pinnedRates.h2d
+                  << std::setw(16) << pageableRates.d2h
+                  << std::setw(14) << pinnedRates.d2h
+                  << std::setw(13) << (pageableRates.h2d > 0.0 ? pinnedRates.h2d / pageableRates.h2d : 0.0) << "x"
+                  << std::setw(13) << (pageableRates.d2h > 0.0 ? pinnedRates.d2h / pageableRates.d2h : 0.0) << "x"
+                  << std::endl;
+    }
+}
+
+// Number of device buffer sets the streaming pipeline rotates through: one being uploaded, one
+// being computed on and one being downloaded
+static const int STREAM_SLOTS = 3;
+
+// Chunk-sized device buffers plus a kernel bound to them
+struct StreamSlot {
+    cl::Buffer d_A, d_B, d_C;
+    cl::Kernel kernel;
+};
+
+// Enqueues every chunk of one streaming pass and waits for it. Uploads go to `upload`, kernels to
+// `compute` and downloads to `download`; ordering comes only from events, so the same code runs
+// serially on one in-order queue or overlapped on several queues / one out-of-order queue.
+static bool run_stream_pass(const cl::CommandQueue& upload, const cl::CommandQueue& compute,
+                            const cl::CommandQueue& download, std::vector<StreamSlot>& slots,
+                            const HostVector& h_A, const HostVector& h_B, HostVector& h_C,
+                            int elements, int chunks, TraceLog* trace, double& overallMs) {
+    cl_int err;
+    int chunkElements = (elements + chunks - 1) / chunks;
+    std::vector<cl::Event> readEvents;
+    std::vector<TraceCommand> commands;
+
+    auto start_overall = std::chrono::steady_clock::now();
+    for (int i = 0; i < chunks; ++i) {
+        int offset = i * chunkElements;
+        int count = std::min(chunkElements, elements - offset);
+        if (count <= 0) break;
+        size_t bytes = sizeof(int) * count;
+        StreamSlot& slot = slots[i % slots.size()];
+
+        // A slot's buffers are free again once the chunk that last used them has been read back
+        std::vector<cl::Event> slotFree;
+        if (i >= (int)slots.size()) slotFree.push_back(readEvents[i - slots.size()]);
+
+        cl::Event writeEventA, writeEventB, kernelEvent, readEventC;
+        err = upload.enqueueWriteBuffer(slot.d_A, CL_FALSE, 0, bytes, h_A.data() + offset, &slotFree, &writeEventA);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to write chunk " << i << "." << std::endl; return false; }
+        err = upload.enqueueWriteBuffer(slot.d_B, CL_FALSE, 0, bytes, h_B.data() + offset, &slotFree, &writeEventB);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to write chunk " << i << "." << std::endl; return false; }
+
+        std::vector<cl::Event> writeEvents = {writeEventA, writeEventB};
+        slot.kernel.setArg(3, count);
+        err = compute.enqueueNDRangeKernel(slot.kernel, cl::NullRange, cl::NDRange(count), cl::NullRange, &writeEvents, &kernelEvent);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to enqueue kernel for chunk " << i << "." << std::endl; return false; }
+
+        std::vector<cl::Event> kernelDependencies = {kernelEvent};
+        err = download.enqueueReadBuffer(slot.d_C, CL_FALSE, 0, bytes, h_C.data() + offset, &kernelDependencies, &readEventC);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to read chunk " << i << "." << std::endl; return false; }
+        readEvents.push_back(readEventC);
+        if (trace) {
+            std::string chunk = "chunk " + std::to_string(i) + " ";
+            commands.push_back({&upload, chunk + "write A", writeEventA});
+            commands.push_back({&upload, chunk + "write B", writeEventB});
+            commands.push_back({&compute, chunk + "vecadd", kernelEvent});
+            commands.push_back({&download, chunk + "read C", readEventC});
+        }
+
+        // Submit right away so the next chunk's upload can start while this one computes
+        upload.flush();
+        compute.flush();
+        download.flush();
+    }
+    upload.finish();
+    compute.finish();
+    download.finish();
+
+    auto end_overall = std::chrono::steady_clock::now();
+    overallMs = std::chrono::duration<double, std::milli>(end_overall - start_overall).count();
+    if (trace) {
+        trace_host_span(trace, upload, "stream pass", steady_ns(start_overall), steady_ns(end_overall));
+        trace_commands(trace, commands, steady_ns(end_overall));
+    }
+    return true;
+}
+
+// Times warmup + measured streaming passes and returns the median wall time
+static bool time_stream(const cl::CommandQueue& upload, const cl::CommandQueue& compute, const cl::CommandQueue& download,
+                        std::vector<StreamSlot>& slots, const HostVector& h_A, const HostVector& h_B, HostVector& h_C,
+                        int elements, const BenchmarkOptions& options, TraceLog* trace, PhaseStats& stats) {
+    std::vector<double> samples;
+    for (int iter = 0; iter < options.warmupIterations + options.iterations; ++iter) {
+        double ms = 0.0;
+        // The last pass is the one verified; poison it first so a chunk that is never read back shows up
+        if (iter == options.warmupIterations + options.iterations - 1) std::fill(h_C.begin(), h_C.end(), VERIFY_POISON);
+        if (!run_stream_pass(upload, compute, download, slots, h_A, h_B, h_C, elements, options.streamChunks, trace, ms)) return false;
+        if (iter >= options.warmupIterations) samples.push_back(ms);
+    }
+    stats = compute_stats(samples);
+    return true;
+}
+
+// Splits the input into options.streamChunks chunks and compares a serial schedule on one in-order
+// queue against overlapping upload / compute / download across options.streamQueues queues
+void run_streaming_pipeline(const cl::Device& device, const cl::Context& context, const cl::CommandQueue& queue,
+                            const cl::Program& program, TraceLog* trace, const BenchmarkOptions& options) {
+    cl_int err;
+    int elements = (int)std::min<size_t>(options.streamBytes / sizeof(int), INT_MAX);
+    int chunkElements = (elements + options.streamChunks - 1) / options.streamChunks;
+    size_t chunkBytes = sizeof(int) * chunkElements;
+
+    HostVector h_A(elements, 1);
+    HostVector h_B(elements, 2);
+    HostVector h_C(elements);
+
+    std::vector<StreamSlot> slots(std::min(STREAM_SLOTS, options.streamChunks));
+    for (auto& slot : slots) {
+        slot.d_A = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY, chunkBytes, nullptr, &err);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create stream buffer." << std::endl; return; }
+        slot.d_B = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY, chunkBytes, nullptr, &err);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create stream buffer." << std::endl; return; }
+        slot.d_C = cl::Buffer(context, CL_MEM_WRITE_ONLY | CL_MEM_HOST_READ_ONLY, chunkBytes, nullptr, &err);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create stream buffer." << std::endl; return; }
+        slot.kernel = cl::Kernel(program, "vecadd", &err);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create kernel 'vecadd'." << std::endl; return; }
+        slot.kernel.setArg(0, slot.d_A);
+        slot.kernel.setArg(1, slot.d_B);
+        slot.kernel.setArg(2, slot.d_C);
+    }
+
+    // One queue means a single out-of-order queue; otherwise separate in-order queues per stage
+    std::vector<cl::CommandQueue> stageQueues;
+    cl_command_queue_properties props = CL_QUEUE_PROFILING_ENABLE;
+    if (options.streamQueues == 1) props |= CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE;
+    for (int i = 0; i < options.streamQueues; ++i) {
+        stageQueues.emplace_back(context, device, props, &err);
+        if (err != CL_SUCCESS) {
+            print_cl_error(err);
+            std::cerr << "Failed to create stream command queue" << (options.streamQueues == 1 ? " (out-of-order not supported?)" : "") << std::endl;
+            return;
+        }
+        trace_queue(trace, device, stageQueues.back(),
+                    options.streamQueues == 1 ? std::string("stream out-of-order queue") : "stream queue " + std::to_string(i));
+    }
+    // With two queues the read shares the compute queue: sharing the upload queue would put read i
+    // ahead of write i + 1 and serialize the whole stream
+    size_t computeIndex = std::min<size_t>(1, stageQueues.size() - 1);
+    size_t downloadIndex = std::min<size_t>(2, stageQueues.size() - 1);
+    const cl::CommandQueue& uploadQueue = stageQueues[0];
+    const cl::CommandQueue& computeQueue = stageQueues[computeIndex];
+    const cl::CommandQueue& downloadQueue = stageQueues[downloadIndex];
+
+    PhaseStats serial, overlapped;
+    if (!time_stream(queue, queue, queue, slots, h_A, h_B, h_C, elements, options, trace, serial)) return;
+    if (!time_stream(uploadQueue, computeQueue, downloadQueue, slots, h_A, h_B, h_C, elements, options, trace, overlapped)) return;
+
+    double totalBytes = 3.0 * sizeof(int) * (double)elements;
+    std::cout << "\n--- Streaming Pipeline (" << elements * sizeof(int) / (1024.0 * 1024.0) << " MB in "
+              << options.streamChunks << " chunks, median of " << options.iterations << " iterations) ---" << std::endl;
+    std::cout << "Serial (1 in-order queue):      " << serial.median << " ms ("
+              << gb_per_s(totalBytes, serial.median) << " GB/s end-to-end)" << std::endl;
+    std::cout << "Overlapped (" << options.streamQueues
+              << (options.streamQueues == 1 ? " out-of-order queue):   " : " in-order queues):    ") << overlapped.median << " ms ("
+              << gb_per_s(totalBytes, overlapped.median) << " GB/s end-to-end)" << std::endl;
+    std::cout << "Overlap speedup:                "
+              << (overlapped.median > 0.0 ? serial.median / overlapped.median : 0.0) << "x" << std::endl;
+    std::cout << "Stage queues:                   write -> queue 0, kernel -> queue " << computeIndex
+              << ", read -> queue " << downloadIndex << std::endl;
+
+    VerifyResult verify = verify_vecadd(h_A.data(), h_B.data(), h_C.data(), elements);
+    std::cout << "Result verification: " << describe_verification(verify) << std::endl;
+}
+
+// Reusable barrier releasing all participants once `threshold` threads have arrived
+class Barrier {
+public:
+    explicit Barrier(int threshold) : threshold(threshold) {}
+    void arrive_and_wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        int arrivedGeneration = generation;
+        if (++arrived == threshold) {
+            arrived = 0;
+            ++generation;
+            released.notify_all();
+            return;
+        }
+        released.wait(lock, [&] { return arrivedGeneration != generation; });
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable released;
+    int threshold;
+    int arrived = 0;
+    int generation = 0;
+};
+
+// Disables auto-vectorization so the scalar host baseline stays scalar at -O2/-O3
+#if defined(__clang__)
+#define HOST_NO_VECTORIZE
+#define HOST_SCALAR_LOOP _Pragma("clang loop vectorize(disable) interleave(disable)")
+#elif defined(__GNUC__)
+#define HOST_NO_VECTORIZE __attribute__((optimize("no-tree-vectorize")))
+#define HOST_SCALAR_LOOP
+#else
+#define HOST_NO_VECTORIZE
+#define HOST_SCALAR_LOOP
+#endif
+
+// Signature shared by the host vecadd implementations: C[i] = A[i] + B[i] for i in [0, n)
+using HostVecaddFn = void (*)(const int* A, const int* B, int* C, size_t n);
+
+HOST_NO_VECTORIZE static void host_vecadd_scalar(const int* A, const int* B, int* C, size_t n) {
+    HOST_SCALAR_LOOP
+    for (size_t i = 0; i < n; ++i) C[i] = A[i] + B[i];
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2"))) static void host_vecadd_avx2(const int* A, const int* B, int* C, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(A + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(B + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(C + i), _mm256_add_epi32(a, b));
+    }
+    for (; i < n; ++i) C[i] = A[i] + B[i];
+}
+
+__attribute__((target("avx512f"))) static void host_vecadd_avx512(const int* A, const int* B, int* C, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i a = _mm512_loadu_si512(A + i);
+        __m512i b = _mm512_loadu_si512(B + i);
+        _mm512_storeu_si512(C + i, _mm512_add_epi32(a, b));
+    }
+    for (; i < n; ++i) C[i] = A[i] + B[i];
+}
+#endif
+
+#if defined(__aarch64__) || defined(__ARM_NEON)
+static void host_vecadd_neon(const int* A, const int* B, int* C, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) vst1q_s32(C + i, vaddq_s32(vld1q_s32(A + i), vld1q_s32(B + i)));
+    for (; i < n; ++i) C[i] = A[i] + B[i];
+}
+#endif
+
+// Picks the widest SIMD implementation the running CPU supports
+static HostVecaddFn best_simd_vecadd(std::string& name) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) { name = "avx512"; return host_vecadd_avx512; }
+    if (__builtin_cpu_supports("avx2")) { name = "avx2"; return host_vecadd_avx2; }
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+    name = "neon";
+    return host_vecadd_neon;
+#endif
+    name = "";
+    return nullptr;
+}
+
+// Logical CPUs this process may run on. On Linux this is the affinity mask, so taskset and cgroup
+// cpusets are honoured; elsewhere it is every CPU the standard library reports.
+static std::vector<unsigned> allowed_cpus() {
+    std::vector<unsigned> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+        }
+    }
+#endif
+    if (cpus.empty()) {
+        for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu) cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+// Pins the calling thread to one logical CPU (Linux only; elsewhere the scheduler decides).
+// Returns false if the kernel refused.
+static bool pin_to_cpu(unsigned cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return true;
+#endif
+}
+
+// Timings of one host implementation
+struct HostResult {
+    std::string name;
+    PhaseStats compute;
+    bool correct = false;
+};
+
+// All host implementations measured for the --host-baseline comparison
+struct HostBaseline {
+    int elements = 0;
+    std::vector<HostResult> results;
+
+    // Fastest implementation by median, or nullptr when nothing ran
+    const HostResult* best() const {
+        const HostResult* fastest = nullptr;
+        for (const auto& result : results) {
+            if (!fastest || result.compute.median < fastest->compute.median) fastest = &result;
+        }
+        return fastest;
+    }
+};
+
+// Times a single-threaded implementation over warmup + measured iterations
+static HostResult time_host_single(const std::string& name, HostVecaddFn fn, const HostVector& h_A,
+                                   const HostVector& h_B, HostVector& h_C, const BenchmarkOptions& options) {
+    std::vector<double> samples;
+    for (int iter = 0; iter < options.warmupIterations + options.iterations; ++iter) {
+        std::fill(h_C.begin(), h_C.end(), 0);
+        auto start = std::chrono::steady_clock::now();
+        fn(h_A.data(), h_B.data(), h_C.data(), h_C.size());
+        auto end = std::chrono::steady_clock::now();
+        if (iter >= options.warmupIterations) samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    HostResult result;
+    result.name = name;
+    result.compute = compute_stats(samples);
+    result.correct = verify_vecadd(h_A.data(), h_B.data(), h_C.data(), h_C.size()).correct;
+    return result;
+}
+
+// Times `fn` split over `threadCount` persistent worker threads, each pinned to its own CPU of the
+// process's affinity mask.
+// The workers are created once and released by a barrier per iteration so thread start-up cost
+// stays out of the measurement.
+static HostResult time_host_threaded(const std::string& name, HostVecaddFn fn, unsigned threadCount,
+                                     const HostVector& h_A, const HostVector& h_B, HostVector& h_C,
+                                     const BenchmarkOptions& options) {
+    size_t n = h_C.size();
+    size_t chunk = (n + threadCount - 1) / threadCount;
+    Barrier startLine((int)threadCount + 1), finishLine((int)threadCount + 1);
+    bool stop = false;
+    std::vector<unsigned> cpus = allowed_cpus();
+    std::vector<char> pinned(threadCount, 0); // One slot per thread, read after they join
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&, t] {
+            pinned[t] = pin_to_cpu(cpus[t % cpus.size()]);
+            size_t begin = std::min(n, t * chunk);
+            size_t count = std::min(n, begin + chunk) - begin;
+            while (true) {
+                startLine.arrive_and_wait();
+                if (stop) break;
+                fn(h_A.data() + begin, h_B.data() + begin, h_C.data() + begin, count);
+                finishLine.arrive_and_wait();
+            }
+        });
+    }
+
+    std::vector<double> samples;
+    for (int iter = 0; iter < options.warmupIterations + options.iterations; ++iter) {
+        std::fill(h_C.begin(), h_C.end(), 0);
+        auto start = std::chrono::steady_clock::now();
+        startLine.arrive_and_wait();
+        finishLine.arrive_and_wait();
+        auto end = std::chrono::steady_clock::now();
+        if (iter >= options.warmupIterations) samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    stop = true;
+    startLine.arrive_and_wait();
+    for (auto& thread : threads) thread.join();
+    size_t unpinned = std::count(pinned.begin(), pinned.end(), 0);
+    if (unpinned > 0) {
+        std::cerr << "Warning: " << unpinned << " of " << threadCount
+                  << " host baseline threads could not be pinned and ran where the scheduler put them." << std::endl;
+    }
+
+    HostResult result;
+    result.name = name + " x" + std::to_string(threadCount) + " threads";
+    result.compute = compute_stats(samples);
+    result.correct = verify_vecadd(h_A.data(), h_B.data(), h_C.data(), h_C.size()).correct;
+    return result;
+}
+
+// Measures the native host implementations of vecadd at DATA_SIZE and prints them
+HostBaseline run_host_baseline(const BenchmarkOptions& options) {
+    HostBaseline baseline;
+    baseline.elements = DATA_SIZE;
+    HostVector h_A(DATA_SIZE, 1);
+    HostVector h_B(DATA_SIZE, 2);
+    HostVector h_C(DATA_SIZE);
+
+    baseline.results.push_back(time_host_single("scalar", host_vecadd_scalar, h_A, h_B, h_C, options));
+    std::string simdName;
+    HostVecaddFn simd = best_simd_vecadd(simdName);
+    if (simd) baseline.results.push_back(time_host_single(simdName, simd, h_A, h_B, h_C, options));
+
+    unsigned threadCount = options.hostThreads > 0 ? (unsigned)options.hostThreads : (unsigned)allowed_cpus().size();
+    if (threadCount > 1) {
+        baseline.results.push_back(time_host_threaded(simd ? simdName : "scalar", simd ? simd : host_vecadd_scalar,
+                                                      threadCount, h_A, h_B, h_C, options));
+    }
+
+    double bytes = 3.0 * sizeof(int) * (double)DATA_SIZE;
+    std::cout << "\n--- Host CPU Baseline (" << DATA_SIZE << " elements, " << options.iterations
+              << " iterations after " << options.warmupIterations << " warmup) ---" << std::endl;
+    std::cout << std::left << std::setw(28) << "Implementation (ms)" << std::right
+              << std::setw(11) << "min"
+              << std::setw(11) << "median"
+              << std::setw(11) << "p95"
+              << std::setw(11) << "p99"
+              << std::setw(11) << "stddev"
+              << std::setw(10) << "cv" << std::endl;
+    for (const auto& result : baseline.results) print_phase_stats(result.name, result.compute);
+    for (const auto& result : baseline.results) {
+        std::cout << std::left << std::setw(28) << result.name << std::right
+                  << gb_per_s(bytes, result.compute.median) << " GB/s, "
+                  << gb_per_s((double)DATA_SIZE, result.compute.median) << " GOP/s, verification "
+                  << (result.correct ? "PASSED" : "FAILED") << std::endl;
+    }
+    return baseline;
+}
+
+// Compares each device result end-to-end (transfers included) against the fastest host implementation
+void print_host_comparison(const std::vector<PipelineResult>& results, const HostBaseline& host) {
+    const HostResult* best = host.best();
+    if (!best || results.empty()) return;
+    std::cout << "\n--- Offload vs Host (" << best->name << ", " << best->compute.median << " ms) ---" << std::endl;
+    for (const auto& result : results) {
+        if (result.elements != host.elements) continue;
+        double ratio = result.overall.median > 0.0 ? best->compute.median / result.overall.median : 0.0;
+        std::cout << std::left << std::setw(16) << strategy_name(result.config.strategy)
+                  << std::setw(13) << variant_name(result.config.variant) << std::right
+                  << "overall " << result.overall.median << " ms, kernel only " << result.kernel.median << " ms -> offload is "
+                  << ratio << "x the host speed" << (ratio >= 1.0 ? " (offload wins)" : " (host wins)") << std::endl;
+    }
+}
+
+// Platform / device / driver strings every result record is tagged with
+struct DeviceIdentity {
+    std::string platform;
+    std::string device;
+    std::string driver;
+};
+
+DeviceIdentity device_identity(const cl::Platform& platform, const cl::Device& device) {
+    DeviceIdentity identity;
+    platform.getInfo(CL_PLATFORM_NAME, &identity.platform);
+    device.getInfo(CL_DEVICE_NAME, &identity.device);
+    device.getInfo(CL_DRIVER_VERSION, &identity.driver);
+    return identity;
+}
+
+// One phase of one measured configuration, as written to --output for regression tracking
+struct ResultRecord {
+    DeviceIdentity identity;
+    std::string test;        // "pipeline", "sweep", "host", "multi_device", ... (see the README)
+    std::string strategy;    // Buffer strategy; empty for host results
+    std::string kernel;      // Kernel variant or host implementation
+    size_t localSize = 0;    // 0 = chosen by the driver
+    long long elements = 0;
+    std::string phase;       // write_a, write_b, kernel, read_c, overall or compute
+    double bytes = 0.0;      // Bytes the phase moves, for GB/s
+    PhaseStats stats;
+    bool verified = false;
+    double ops = 0.0;        // Operations the phase performs, for GOP/s; 0 = one per element
+    double watts = 0.0;      // Average power while the phase's benchmark ran; 0 = not sampled
+};
+
+// Adds one record per phase of a pipeline result
+void append_pipeline_records(std::vector<ResultRecord>& records, const DeviceIdentity& identity,
+                             const std::string& test, const PipelineResult& result) {
+    double bufferBytes = (double)result.elements * sizeof(int);
+    const std::pair<const char*, const PhaseStats*> phases[] = {
+        {"write_a", &result.writeA}, {"write_b", &result.writeB}, {"kernel", &result.kernel},
+        {"read_c", &result.readC}, {"overall", &result.overall}, {"overhead", &result.overhead},
+    };
+    for (const auto& phase : phases) {
+        if (phase.second->count == 0) continue;
+        ResultRecord record;
+        record.identity = identity;
+        record.test = test;
+        record.strategy = strategy_name(result.config.strategy);
+        record.kernel = variant_name(result.config.variant);
+        record.localSize = result.config.localSize;
+        record.elements = result.elements;
+        record.phase = phase.first;
+        // Writes and the read move one buffer; the kernel and the whole pass touch all three
+        // Overhead moves no data of its own
+        record.bytes = record.phase == "overhead" ? 0.0 :
+                       (record.phase == "kernel" || record.phase == "overall") ? 3.0 * bufferBytes : bufferBytes;
+        record.stats = *phase.second;
+        record.verified = result.verify.correct;
+        records.push_back(record);
+    }
+}
+
+// Adds one "compute" record per host implementation
+void append_host_records(std::vector<ResultRecord>& records, const HostBaseline& host) {
+    for (const auto& result : host.results) {
+        ResultRecord record;
+        record.identity.platform = "host";
+        record.identity.device = "host";
+        record.test = "host";
+        record.kernel = result.name;
+        record.elements = host.elements;
+        record.phase = "compute";
+        record.bytes = 3.0 * sizeof(int) * (double)host.elements;
+        record.stats = result.compute;
+        record.verified = result.correct;
+        records.push_back(record);
+    }
+}
+
+// Escapes a string for use inside a JSON string literal
+static std::string json_escape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        switch (c) {
+        case '"': escaped += "\\\""; break;
+        case '\\': escaped += "\\\\"; break;
+        case '\n': escaped += "\\n"; break;
+        case '\t': escaped += "\\t"; break;
+        default:
+            if ((unsigned char)c < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                escaped += buf;
+            } else {
+                escaped += c;
+            }
+        }
+    }
+    return escaped;
+}
+
+// Quotes a CSV field when it contains a separator, quote or line break
+static std::string csv_field(const std::string& text) {
+    if (text.find_first_of(",\"\n") == std::string::npos) return text;
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"') quoted += '"';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+// Current UTC time as ISO 8601, stamped on every record of a run
+static std::string utc_timestamp() {
+    std::time_t now = std::time(nullptr);
+    std::tm utc{};
+#ifdef _WIN32
+    gmtime_s(&utc, &now);
+#else
+    gmtime_r(&now, &utc);
+#endif
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", &utc);
+    return buf;
+}
+
+// Writes the records to path as JSON lines or CSV (chosen from the extension for OutputFormat::Auto)
+bool write_result_records(const std::string& path, OutputFormat format, const std::vector<ResultRecord>& records) {
+    if (format == OutputFormat::Auto) {
+        format = std::filesystem::path(path).extension() == ".csv" ? OutputFormat::Csv : OutputFormat::JsonLines;
+    }
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Failed to open result file " << path << std::endl;
+        return false;
+    }
+    out << std::setprecision(9);
+    std::string timestamp = utc_timestamp();
+
+    if (format == OutputFormat::Csv) {
+        out << "timestamp,platform,device,driver,test,strategy,kernel,local_size,elements,phase,count,"
+               "min_ms,median_ms,mean_ms,p95_ms,p99_ms,max_ms,stddev_ms,cv,gbps,verified,watts,joules_per_gb,gops_per_watt,samples_ms\n";
+    }
+    for (const auto& record : records) {
+        const PhaseStats& s = record.stats;
+        double gbps = gb_per_s(record.bytes, s.median);
+        // Energy figures are 0 when the record's phase was not sampled
+        double joulesPerGb = record.watts > 0.0 && gbps > 0.0 ? record.watts / gbps : 0.0;
+        double gopsPerWatt = record.watts > 0.0 ? gb_per_s(record.ops > 0.0 ? record.ops : (double)record.elements, s.median) / record.watts : 0.0;
+        std::ostringstream samples;
+        samples << std::setprecision(9);
+        for (size_t i = 0; i < s.samples.size(); ++i) {
+            samples << (i ? (format == OutputFormat::Csv ? ";" : ",") : "") << s.samples[i];
+        }
+
+        if (format == OutputFormat::Csv) {
+            out << timestamp << ',' << csv_field(record.identity.platform) << ',' << csv_field(record.identity.device)
+                << ',' << csv_field(record.identity.driver) << ',' << record.test << ',' << record.strategy
+                << ',' << csv_field(record.kernel) << ',' << record.localSize << ',' << record.elements
+                << ',' << record.phase << ',' << s.count << ',' << s.min << ',' << s.median << ',' << s.mean
+                << ',' << s.p95 << ',' << s.p99 << ',' << s.max << ',' << s.stddev << ',' << s.cv
+                << ',' << gbps << ',' << (record.verified ? "true" : "false") << ',' << record.watts
+                << ',' << joulesPerGb << ',' << gopsPerWatt << ',' << samples.str() << '\n';
+        } else {
+            out << "{\"timestamp\":\"" << timestamp << "\""
+                << ",\"platform\":\"" << json_escape(record.identity.platform) << "\""
+                << ",\"device\":\"" << json_escape(record.identity.device) << "\""
+                << ",\"driver\":\"" << json_escape(record.identity.driver) << "\""
+                << ",\"test\":\"" << record.test << "\""
+                << ",\"strategy\":\"" << record.strategy << "\""
+                << ",\"kernel\":\"" << json_escape(record.kernel) << "\""
+                << ",\"local_size\":" << record.localSize
+                << ",\"elements\":" << record.elements
+                << ",\"phase\":\"" << record.phase << "\""
+                << ",\"count\":" << s.count
+                << ",\"min_ms\":" << s.min << ",\"median_ms\":" << s.median << ",\"mean_ms\":" << s.mean
+                << ",\"p95_ms\":" << s.p95 << ",\"p99_ms\":" << s.p99 << ",\"max_ms\":" << s.max
+                << ",\"stddev_ms\":" << s.stddev << ",\"cv\":" << s.cv
+                << ",\"gbps\":" << gbps
+                << ",\"verified\":" << (record.verified ? "true" : "false")
+                << ",\"watts\":" << record.watts << ",\"joules_per_gb\":" << joulesPerGb
+                << ",\"gops_per_watt\":" << gopsPerWatt
+                << ",\"samples_ms\":[" << samples.str() << "]}\n";
+        }
+    }
+    if (!out) {
+        std::cerr << "Failed to write result file " << path << std::endl;
+        return false;
+    }
+    std::cout << "\nWrote " << records.size() << " result records to " << path << std::endl;
+    return true;
+}
+
+// Writes the --trace timeline as Chrome trace JSON for ui.perfetto.dev or chrome://tracing.
+// Executions are complete events on their queue's track; the QUEUED -> START wait of each command
+// is an async slice, because waits overlap each other and the executions.
+bool write_chrome_trace(const std::string& path, const TraceLog& trace) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Failed to open trace file " << path << std::endl;
+        return false;
+    }
+    double originNs = 0.0;
+    for (size_t i = 0; i < trace.spans.size(); ++i) {
+        if (i == 0 || trace.spans[i].queuedNs < originNs) originNs = trace.spans[i].queuedNs;
+    }
+    auto us = [&](double ns) { return (ns - originNs) * 1e-3; };
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    const char* separator = "\n";
+    for (size_t i = 0; i < trace.processes.size(); ++i) {
+        out << separator << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":" << i + 1
+            << ",\"args\":{\"name\":\"" << json_escape(trace.processes[i].second) << "\"}}";
+        separator = ",\n";
+    }
+    for (const auto& thread : trace.threads) {
+        out << separator << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << thread.first.first
+            << ",\"tid\":" << thread.first.second << ",\"args\":{\"name\":\"" << json_escape(thread.second) << "\"}}";
+    }
+    int waitId = 0;
+    for (const auto& span : trace.spans) {
+        out << separator << "{\"ph\":\"X\",\"cat\":\"" << (span.device ? "device" : "host") << "\",\"name\":\""
+            << json_escape(span.name) << "\",\"pid\":" << span.pid << ",\"tid\":" << span.tid
+            << ",\"ts\":" << us(span.startNs) << ",\"dur\":" << std::max(0.0, span.endNs - span.startNs) * 1e-3;
+        if (span.device) {
+            out << ",\"args\":{\"queued_to_submit_us\":" << (span.submitNs - span.queuedNs) * 1e-3
+                << ",\"submit_to_start_us\":" << (span.startNs - span.submitNs) * 1e-3 << "}";
+        }
+        out << "}";
+        separator = ",\n";
+        if (!span.device || span.startNs <= span.queuedNs) continue;
+        std::ostringstream common;
+        common << ",\"cat\":\"wait\",\"name\":\"" << json_escape(span.name) << " (waiting)\",\"id\":" << ++waitId
+               << ",\"pid\":" << span.pid << ",\"tid\":" << span.tid;
+        out << separator << "{\"ph\":\"b\"" << common.str() << ",\"ts\":" << us(span.queuedNs) << "}";
+        out << separator << "{\"ph\":\"e\"" << common.str() << ",\"ts\":" << us(span.startNs) << "}";
+    }
+    out << "\n]}\n";
+    if (!out) {
+        std::cerr << "Failed to write trace file " << path << std::endl;
+        return false;
+    }
+    std::cout << "\nWrote " << trace.spans.size() << " trace spans to " << path << std::endl;
+    return true;
+}
+
+// Splits one JSON-lines record written by write_result_records into name -> raw value. Only the
+// flat shape written above is understood; an array value is kept as its comma-separated contents.
+static bool split_json_record(const std::string& line, std::map<std::string, std::string>& fields) {
+    size_t pos = line.find('{');
+    if (pos == std::string::npos) return false;
+    auto readString = [&](std::string& text) {
+        text.clear();
+        for (++pos; pos < line.size() && line[pos] != '"'; ++pos) {
+            if (line[pos] == '\\' && pos + 1 < line.size()) {
+                char c = line[++pos];
+                if (c == 'n') text += '\n';
+                else if (c == 't') text += '\t';
+                else if (c == 'u' && pos + 4 < line.size()) {
+                    text += (char)std::strtol(line.substr(pos + 1, 4).c_str(), nullptr, 16);
+                    pos += 4;
+                } else text += c;
+            } else {
+                text += line[pos];
+            }
+        }
+        ++pos; // Closing quote
+        return pos <= line.size();
+    };
+    while (true) {
+        pos = line.find_first_of("\"}", pos + 1);
+        if (pos == std::string::npos) return false;
+        if (line[pos] == '}') return true;
+        std::string name, value;
+        if (!readString(name)) return false;
+        pos = line.find(':', pos);
+        if (pos == std::string::npos) return false;
+        for (++pos; pos < line.size() && line[pos] == ' '; ++pos) {}
+        if (pos < line.size() && line[pos] == '"') {
+            if (!readString(value)) return false;
+        } else if (pos < line.size() && line[pos] == '[') {
+            size_t end = line.find(']', pos);
+            if (end == std::string::npos) return false;
+            value = line.substr(pos + 1, end - pos - 1);
+            pos = end + 1;
+        } else {
+            size_t end = line.find_first_of(",}", pos);
+            if (end == std::string::npos) return false;
+            value = line.substr(pos, end - pos);
+            pos = end;
+        }
+        fields[name] = value;
+        --pos; // The search for the next name starts after the separator
+    }
+}
+
+// Splits one CSV line into fields, honouring csv_field's quoting
+static std::vector<std::string> split_csv_line(const std::string& line) {
+    std::vector<std::string> fields(1);
+    bool quoted = false;
+    for (size_t i = 0; i < line.size(); ++i) {
+        char c = line[i];
+        if (quoted) {
+            if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') { fields.back() += '"'; ++i; }
+            else if (c == '"') quoted = false;
+            else fields.back() += c;
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields.emplace_back();
+        } else if (c != '\r') {
+            fields.back() += c;
+        }
+    }
+    return fields;
+}
+
+// Rebuilds a record from the named fields of one JSON or CSV line
+static ResultRecord record_from_fields(const std::map<std::string, std::string>& fields) {
+    auto get = [&](const char* name) {
+        auto it = fields.find(name);
+        return it == fields.end() ? std::string() : it->second;
+    };
+    auto num = [&](const char* name) { return std::strtod(get(name).c_str(), nullptr); };
+
+    ResultRecord record;
+    record.identity.platform = get("platform");
+    record.identity.device = get("device");
+    record.identity.driver = get("driver");
+    record.test = get("test");
+    record.strategy = get("strategy");
+    record.kernel = get("kernel");
+    record.localSize = (size_t)num("local_size");
+    record.elements = (long long)num("elements");
+    record.phase = get("phase");
+    record.stats.count = (size_t)num("count");
+    record.stats.min = num("min_ms");
+    record.stats.median = num("median_ms");
+    record.stats.mean = num("mean_ms");
+    record.stats.p95 = num("p95_ms");
+    record.stats.p99 = num("p99_ms");
+    record.stats.max = num("max_ms");
+    record.stats.stddev = num("stddev_ms");
+    record.stats.cv = num("cv");
+    record.bytes = num("gbps") * record.stats.median * 1e6;
+    record.verified = get("verified") == "true";
+    record.watts = num("watts");
+    std::string samples = get("samples_ms");
+    for (char& c : samples) if (c == ';') c = ',';
+    std::istringstream list(samples);
+    std::string sample;
+    while (std::getline(list, sample, ',')) {
+        if (!sample.empty()) record.stats.samples.push_back(std::strtod(sample.c_str(), nullptr));
+    }
+    return record;
+}
+
+// Reads a file written by write_result_records (JSON lines or CSV, detected from the content)
+bool load_result_records(const std::string& path, std::vector<ResultRecord>& records) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Cannot open baseline file: " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    std::vector<std::string> header;
+    int lineNo = 0;
+    while (std::getline(file, line)) {
+        ++lineNo;
+        if (line.empty()) continue;
+        std::map<std::string, std::string> fields;
+        if (line[0] == '{') {
+            if (!split_json_record(line, fields)) {
+                std::cerr << "Malformed record on line " << lineNo << " of " << path << std::endl;
+                return false;
+            }
+        } else if (header.empty()) {
+            header = split_csv_line(line);
+            continue;
+        } else {
+            std::vector<std::string> values = split_csv_line(line);
+            for (size_t i = 0; i < header.size() && i < values.size(); ++i) fields[header[i]] = values[i];
+        }
+        records.push_back(record_from_fields(fields));
+    }
+    return true;
+}
+
+// Identifies the same measurement across runs; the driver version is left out on purpose so that
+// driver upgrades can be compared
+static std::string record_key(const ResultRecord& record) {
+    return record.identity.platform + '\t' + record.identity.device + '\t' + record.test + '\t' + record.strategy +
+           '\t' + record.kernel + '\t' + std::to_string(record.elements) + '\t' + record.phase;
+}
+
+// Two-sided p-value of the Mann-Whitney U test (normal approximation with tie and continuity
+// correction) that a and b come from the same distribution; 1 when there are too few samples
+double mann_whitney_p(const std::vector<double>& a, const std::vector<double>& b) {
+    size_t n1 = a.size(), n2 = b.size(), n = n1 + n2;
+    if (n1 < 2 || n2 < 2) return 1.0;
+    std::vector<std::pair<double, int>> all;
+    for (double x : a) all.push_back({x, 0});
+    for (double x : b) all.push_back({x, 1});
+    std::sort(all.begin(), all.end());
+
+    // Average ranks over ties, accumulating sum(t^3 - t) for the variance correction
+    double rankSumA = 0.0, tieTerm = 0.0;
+    for (size_t i = 0; i < n;) {
+        size_t j = i;
+        while (j < n && all[j].first == all[i].first) ++j;
+        double rank = (double)(i + j + 1) / 2.0; // Ranks are 1-based
+        for (size_t k = i; k < j; ++k) if (all[k].second == 0) rankSumA += rank;
+        double t = (double)(j - i);
+        tieTerm += t * t * t - t;
+        i = j;
+    }
+    double u = rankSumA - (double)n1 * (n1 + 1) / 2.0;
+    double mu = (double)n1 * n2 / 2.0;
+    double sigma = std::sqrt((double)n1 * n2 / 12.0 * ((double)(n + 1) - tieTerm / ((double)n * (n - 1))));
+    if (sigma == 0.0) return 1.0;
+    double z = (std::fabs(u - mu) - 0.5) / sigma;
+    if (z < 0.0) z = 0.0;
+    return std::erfc(z / std::sqrt(2.0));
+}
+
+// Diffs the phases measured in this run against a baseline file and returns how many regressed:
+// slower by more than options.regressionThreshold with Mann-Whitney p below options.significance
+int compare_with_baseline(const std::vector<ResultRecord>& baseline, const std::vector<ResultRecord>& current,
+                          const BenchmarkOptions& options) {
+    std::map<std::string, const ResultRecord*> byKey;
+    for (const auto& record : baseline) byKey[record_key(record)] = &record;
+
+    std::cout << "\n--- Baseline Comparison (" << options.baselinePath << ", threshold "
+              << options.regressionThreshold * 100.0 << "%, alpha " << options.significance << ") ---" << std::endl;
+    std::cout << std::left << std::setw(28) << "Device" << std::setw(34) << "Config" << std::setw(9) << "Phase" << std::right
+              << std::setw(12) << "Base (ms)"
+              << std::setw(12) << "Now (ms)"
+              << std::setw(10) << "Delta"
+              << std::setw(10) << "p"
+              << "  Verdict" << std::endl;
+
+    int regressions = 0, matched = 0;
+    std::map<std::string, std::string> driverChanges; // Device -> "old -> new"
+    for (const auto& record : current) {
+        auto found = byKey.find(record_key(record));
+        if (found == byKey.end()) continue;
+        const ResultRecord& base = *found->second;
+        byKey.erase(found);
+        ++matched;
+
+        double delta = base.stats.median > 0.0 ? record.stats.median / base.stats.median - 1.0 : 0.0;
+        double p = mann_whitney_p(base.stats.samples, record.stats.samples);
+        bool significant = p < options.significance;
+        const char* verdict = "";
+        if (significant && delta > options.regressionThreshold) {
+            verdict = "REGRESSED";
+            ++regressions;
+        } else if (significant && delta < -options.regressionThreshold) {
+            verdict = "improved";
+        }
+        std::string config = record.test + " " + (record.strategy.empty() ? "" : record.strategy + " ") + record.kernel +
+                             " " + std::to_string(record.elements);
+        std::ostringstream deltaText;
+        deltaText << std::showpos << std::fixed << std::setprecision(1) << delta * 100.0 << "%";
+        std::cout << std::left << std::setw(28) << record.identity.device.substr(0, 27)
+                  << std::setw(34) << config.substr(0, 33)
+                  << std::setw(9) << record.phase << std::right
+                  << std::setw(12) << base.stats.median
+                  << std::setw(12) << record.stats.median
+                  << std::setw(10) << deltaText.str()
+                  << std::setw(10) << p
+                  << "  " << verdict << std::endl;
+        if (base.identity.driver != record.identity.driver) {
+            driverChanges[record.identity.device] = base.identity.driver + " -> " + record.identity.driver;
+        }
+    }
+    for (const auto& change : driverChanges) {
+        std::cout << "Driver changed on " << change.first << ": " << change.second << std::endl;
+    }
+    std::cout << matched << " phases compared, " << regressions << " regressed";
+    if (!byKey.empty()) std::cout << ", " << byKey.size() << " baseline phases not measured in this run";
+    std::cout << std::endl;
+    return regressions;
+}
+
+// Isolated launches whose QUEUED -> SUBMIT -> START -> END profile is sampled by --launch-overhead
+static const int LAUNCH_LATENCY_SAMPLES = 200;
+
+// Duration between two profiling timestamps of an event in milliseconds
+static double event_interval_ms(const cl::Event& event, cl_profiling_info from, cl_profiling_info to) {
+    cl_ulong timeFrom = 0, timeTo = 0;
+    event.getProfilingInfo(from, &timeFrom);
+    event.getProfilingInfo(to, &timeTo);
+    return timeTo > timeFrom ? (double)(timeTo - timeFrom) * 1e-6 : 0.0;
+}
+
+// The same statistics with every value multiplied by factor (e.g. ms -> us for display)
+static PhaseStats scaled_stats(PhaseStats stats, double factor) {
+    stats.min *= factor;
+    stats.max *= factor;
+    stats.mean *= factor;
+    stats.median *= factor;
+    stats.p95 *= factor;
+    stats.p99 *= factor;
+    stats.stddev *= factor;
+    for (double& sample : stats.samples) sample *= factor;
+    return stats;
+}
+
+// Measures the fixed cost of tiny kernels: host enqueue cost over a burst of options.launchCount
+// launches, the QUEUED -> SUBMIT -> START -> END profile of isolated launches, and the host
+// round trip of queue.finish() on an idle queue and right after one launch
+void run_launch_overhead(const cl::Context& context, const cl::CommandQueue& queue, const cl::Program& program,
+                         TraceLog* trace, const BenchmarkOptions& options, const DeviceIdentity& identity, std::vector<ResultRecord>& records) {
+    cl_int err;
+    cl::Buffer d_one(context, CL_MEM_READ_WRITE, sizeof(int), nullptr, &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create launch overhead buffer." << std::endl; return; }
+
+    // An empty kernel and a one-element vecadd: launch cost with and without argument / memory traffic
+    cl::Kernel empty(program, "empty_kernel", &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create kernel 'empty_kernel'." << std::endl; return; }
+    cl::Kernel single(program, "vecadd", &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create kernel 'vecadd'." << std::endl; return; }
+    single.setArg(0, d_one);
+    single.setArg(1, d_one);
+    single.setArg(2, d_one);
+    single.setArg(3, 1);
+
+    std::cout << "\n--- Launch Overhead (" << options.launchCount << " back-to-back launches, "
+              << LAUNCH_LATENCY_SAMPLES << " isolated) ---" << std::endl;
+    std::cout << std::left << std::setw(28) << "Latency (us)" << std::right
+              << std::setw(11) << "min"
+              << std::setw(11) << "median"
+              << std::setw(11) << "p95"
+              << std::setw(11) << "p99"
+              << std::setw(11) << "stddev"
+              << std::setw(10) << "cv" << std::endl;
+
+    const std::pair<const char*, cl::Kernel*> kernels[] = {{"empty_kernel", &empty}, {"vecadd x1", &single}};
+    for (const auto& entry : kernels) {
+        cl::Kernel& kernel = *entry.second;
+        auto record = [&](const char* phase, const std::string& label, const std::vector<double>& samplesMs) {
+            ResultRecord result;
+            result.identity = identity;
+            result.test = "launch";
+            result.kernel = entry.first;
+            result.elements = 1;
+            result.phase = phase;
+            result.stats = compute_stats(samplesMs);
+            result.verified = true;
+            records.push_back(result);
+            print_phase_stats(std::string(entry.first) + " " + label, scaled_stats(result.stats, 1000.0));
+        };
+
+        // Burst: host cost of each enqueue call while the device drains the queue behind it
+        for (int i = 0; i < options.warmupIterations; ++i) queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(1), cl::NullRange);
+        queue.finish();
+        std::vector<double> enqueueSamples;
+        enqueueSamples.reserve(options.launchCount);
+        auto burstStart = std::chrono::steady_clock::now();
+        for (int i = 0; i < options.launchCount; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            err = queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(1), cl::NullRange);
+            auto end = std::chrono::steady_clock::now();
+            if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to enqueue kernel '" << entry.first << "'." << std::endl; return; }
+            enqueueSamples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        queue.finish();
+        auto burstEnd = std::chrono::steady_clock::now();
+        double burstMs = std::chrono::duration<double, std::milli>(burstEnd - burstStart).count();
+        trace_host_span(trace, queue, std::string(entry.first) + " enqueue burst", steady_ns(burstStart), steady_ns(burstEnd));
+
+        // Isolated launches: each one alone on an idle queue, profiled and waited for
+        std::vector<double> queuedToSubmit, submitToStart, startToEnd, roundTrip, idleFinish;
+        for (int i = 0; i < LAUNCH_LATENCY_SAMPLES; ++i) {
+            cl::Event event;
+            auto start = std::chrono::steady_clock::now();
+            err = queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(1), cl::NullRange, nullptr, &event);
+            if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to enqueue kernel '" << entry.first << "'." << std::endl; return; }
+            queue.finish();
+            auto end = std::chrono::steady_clock::now();
+            roundTrip.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+            queuedToSubmit.push_back(event_interval_ms(event, CL_PROFILING_COMMAND_QUEUED, CL_PROFILING_COMMAND_SUBMIT));
+            submitToStart.push_back(event_interval_ms(event, CL_PROFILING_COMMAND_SUBMIT, CL_PROFILING_COMMAND_START));
+            startToEnd.push_back(event_interval_ms(event, CL_PROFILING_COMMAND_START, CL_PROFILING_COMMAND_END));
+            trace_commands(trace, {{&queue, entry.first, event}}, steady_ns(end));
+
+            // finish() with nothing outstanding: the floor of any host <-> runtime synchronisation
+            start = std::chrono::steady_clock::now();
+            queue.finish();
+            end = std::chrono::steady_clock::now();
+            idleFinish.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        }
+
+        record("enqueue", "enqueue (host):", enqueueSamples);
+        record("queued_submit", "QUEUED->SUBMIT:", queuedToSubmit);
+        record("submit_start", "SUBMIT->START:", submitToStart);
+        record("start_end", "START->END:", startToEnd);
+        record("round_trip", "enqueue+finish:", roundTrip);
+        record("finish_idle", "idle finish():", idleFinish);
+        std::cout << std::left << std::setw(28) << (std::string(entry.first) + " throughput:") << std::right
+                  << (burstMs > 0.0 ? options.launchCount / (burstMs * 1e-3) : 0.0) << " launches/s (burst incl. final finish)" << std::endl;
+    }
+}
+
+// Ways of submitting a batch of small vecadd jobs compared by --batch
+enum class BatchStrategy {
+    FinishEach,     // finish() after every job
+    TrailingFinish, // All jobs back-to-back, one finish() at the end
+    EventChain,     // Each job waits on the previous job's event on an out-of-order queue; the host waits on the last one
+    Fused,          // One launch over a 2D NDRange: (element, job)
+};
+
+static const BatchStrategy ALL_BATCH_STRATEGIES[] = {
+    BatchStrategy::FinishEach, BatchStrategy::TrailingFinish, BatchStrategy::EventChain, BatchStrategy::Fused,
+};
+
+static const char* batch_strategy_name(BatchStrategy strategy) {
+    switch (strategy) {
+    case BatchStrategy::FinishEach: return "finish-each";
+    case BatchStrategy::TrailingFinish: return "trailing-finish";
+    case BatchStrategy::EventChain: return "event-chain";
+    case BatchStrategy::Fused: return "fused-2d";
+    }
+    return "unknown";
+}
+
+// Submits options.batchJobs jobs of options.batchElements elements each, job j covering
+// [j * batchElements, (j + 1) * batchElements) of A/B/C, and waits for all of them
+static bool submit_batch(const cl::CommandQueue& queue, const cl::Kernel& single, const cl::Kernel& fused,
+                         BatchStrategy strategy, const BenchmarkOptions& options) {
+    cl_int err = CL_SUCCESS;
+    size_t jobElements = (size_t)options.batchElements;
+    if (strategy == BatchStrategy::Fused) {
+        err = queue.enqueueNDRangeKernel(fused, cl::NullRange, cl::NDRange(jobElements, (size_t)options.batchJobs), cl::NullRange);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to enqueue kernel 'vecadd_batched'." << std::endl; return false; }
+        return queue.finish() == CL_SUCCESS;
+    }
+
+    cl::Event previous;
+    for (int job = 0; job < options.batchJobs; ++job) {
+        // The global offset moves each launch onto its own slice of the shared buffers
+        cl::NDRange offset((size_t)job * jobElements);
+        if (strategy == BatchStrategy::EventChain && job > 0) {
+            std::vector<cl::Event> dependency = {previous};
+            cl::Event next;
+            err = queue.enqueueNDRangeKernel(single, offset, cl::NDRange(jobElements), cl::NullRange, &dependency, &next);
+            previous = next;
+        } else if (strategy == BatchStrategy::EventChain) {
+            err = queue.enqueueNDRangeKernel(single, offset, cl::NDRange(jobElements), cl::NullRange, nullptr, &previous);
+        } else {
+            err = queue.enqueueNDRangeKernel(single, offset, cl::NDRange(jobElements), cl::NullRange);
+        }
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to enqueue kernel 'vecadd'." << std::endl; return false; }
+        if (strategy == BatchStrategy::FinishEach) {
+            err = queue.finish();
+            if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to finish batch job." << std::endl; return false; }
+        }
+    }
+    if (strategy == BatchStrategy::EventChain) {
+        // Flush so the chain is submitted, then block on its tail instead of draining the queue
+        queue.flush();
+        err = previous.wait();
+    } else if (strategy == BatchStrategy::TrailingFinish) {
+        err = queue.finish();
+    }
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to wait for batch." << std::endl; return false; }
+    return true;
+}
+
+// Times options.batchJobs small vecadd jobs under each BatchStrategy and reports jobs/s, so the
+// cost of synchronising after every request can be weighed against batching them
+void run_batched_submission(const cl::Device& device, const cl::Context& context, const cl::CommandQueue& queue,
+                            const cl::Program& program, TraceLog* trace, const BenchmarkOptions& options, const DeviceIdentity& identity,
+                            std::vector<ResultRecord>& records) {
+    cl_int err;
+    size_t elements = (size_t)options.batchJobs * options.batchElements;
+    size_t bytes = sizeof(int) * elements;
+    if (elements > (size_t)INT_MAX) {
+        std::cerr << "Batch of " << elements << " elements is too large for the int-indexed kernels." << std::endl;
+        return;
+    }
+
+    HostVector h_A(elements, 1);
+    HostVector h_B(elements, 2);
+    HostVector h_C(elements);
+    cl::Buffer d_A(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, bytes, h_A.data(), &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create buffer d_A." << std::endl; return; }
+    cl::Buffer d_B(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, bytes, h_B.data(), &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create buffer d_B." << std::endl; return; }
+    cl::Buffer d_C(context, CL_MEM_WRITE_ONLY, bytes, nullptr, &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create buffer d_C." << std::endl; return; }
+
+    cl::Kernel single(program, "vecadd", &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create kernel 'vecadd'." << std::endl; return; }
+    single.setArg(0, d_A);
+    single.setArg(1, d_B);
+    single.setArg(2, d_C);
+    single.setArg(3, (int)elements);
+    cl::Kernel fused(program, "vecadd_batched", &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create kernel 'vecadd_batched'." << std::endl; return; }
+    fused.setArg(0, d_A);
+    fused.setArg(1, d_B);
+    fused.setArg(2, d_C);
+    fused.setArg(3, options.batchElements);
+
+    // On the in-order session queue the chain's wait lists would be redundant; an out-of-order queue
+    // leaves them as the only ordering between jobs
+    cl::CommandQueue chainQueue(context, device, CL_QUEUE_PROFILING_ENABLE | CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE, &err);
+    bool chainOutOfOrder = err == CL_SUCCESS;
+    if (chainOutOfOrder) {
+        trace_queue(trace, device, chainQueue, "batch out-of-order queue");
+    } else {
+        chainQueue = queue;
+    }
+
+    std::cout << "\n--- Batched Submission (" << options.batchJobs << " jobs of " << options.batchElements
+              << " elements, median of " << options.iterations << " iterations) ---" << std::endl;
+    if (!chainOutOfOrder) {
+        std::cout << "Note: out-of-order queues are not supported; event-chain runs on the in-order queue,"
+                  << " where its dependencies are redundant" << std::endl;
+    }
+    std::cout << std::left << std::setw(20) << "Strategy" << std::right
+              << std::setw(14) << "Batch (ms)"
+              << std::setw(14) << "Per job (us)"
+              << std::setw(14) << "Jobs/s"
+              << "  Verification" << std::endl;
+
+    for (BatchStrategy strategy : ALL_BATCH_STRATEGIES) {
+        std::vector<double> samples;
+        int totalIterations = options.warmupIterations + options.iterations;
+        for (int iter = 0; iter < totalIterations; ++iter) {
+            if (iter == totalIterations - 1) {
+                // Poison C before the verified pass, outside the timed window
+                queue.enqueueFillBuffer(d_C, VERIFY_POISON, 0, bytes);
+                queue.finish();
+            }
+            const cl::CommandQueue& batchQueue = strategy == BatchStrategy::EventChain ? chainQueue : queue;
+            auto start = std::chrono::steady_clock::now();
+            if (!submit_batch(batchQueue, single, fused, strategy, options)) return;
+            auto end = std::chrono::steady_clock::now();
+            // Jobs are submitted without events on purpose, so only the host side is traced
+            trace_host_span(trace, batchQueue, std::string("batch ") + batch_strategy_name(strategy), steady_ns(start), steady_ns(end));
+            if (iter >= options.warmupIterations) samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        err = queue.enqueueReadBuffer(d_C, CL_TRUE, 0, bytes, h_C.data());
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to read buffer d_C." << std::endl; return; }
+        VerifyResult verify = verify_vecadd(h_A.data(), h_B.data(), h_C.data(), elements);
+
+        ResultRecord record;
+        record.identity = identity;
+        record.test = "batch";
+        record.kernel = batch_strategy_name(strategy);
+        record.elements = (long long)elements;
+        record.phase = "overall";
+        record.bytes = 3.0 * (double)bytes;
+        record.stats = compute_stats(samples);
+        record.verified = verify.correct;
+        records.push_back(record);
+
+        double median = record.stats.median;
+        std::cout << std::left << std::setw(20) << batch_strategy_name(strategy) << std::right
+                  << std::setw(14) << median
+                  << std::setw(14) << median * 1000.0 / options.batchJobs
+                  << std::setw(14) << (median > 0.0 ? options.batchJobs / (median * 1e-3) : 0.0)
+                  << "  " << (verify.correct ? "PASSED" : describe_verification(verify)) << std::endl;
+    }
+}
+
+static bool data_type_supported(const cl::Device& device, DataType type) {
+    const char* extension = data_type_extension(type);
+    if (!extension) return true;
+    std::string extensions;
+    device.getInfo(CL_DEVICE_EXTENSIONS, &extensions);
+    return extensions.find(extension) != std::string::npos;
+}
+
+// Kernel bodies shared by every element type; T, MULADD and FMA_CHAIN come from the prologue
+// written by typed_kernel_source()
+static const std::string typed_kernel_body = R"(
+    __kernel void vecadd_typed(__global const T *A, __global const T *B, __global T *C, const int N)
+    {
+        int i = get_global_id(0);
+        if (i < N) {
+            C[i] = A[i] + B[i];
+        }
+    }
+
+    // FMA_CHAIN dependent multiply-adds per element: compute-bound where vecadd_typed is memory-bound.
+    // The multiplier is loaded rather than constant so the chain cannot be folded away.
+    __kernel void fma_chain_typed(__global const T *A, __global const T *B, __global T *C, const int N)
+    {
+        int i = get_global_id(0);
+        if (i < N) {
+            T a = A[i];
+            T b = B[i];
+            T acc = a;
+            for (int k = 0; k < FMA_CHAIN; ++k) {
+                acc = MULADD(acc, a, b);
+            }
+            C[i] = acc;
+        }
+    }
+)";
+
+// Generates the program source for one element type
+static std::string typed_kernel_source(DataType type, int fmaChain) {
+    std::ostringstream source;
+    if (const char* extension = data_type_extension(type)) {
+        source << "#pragma OPENCL EXTENSION " << extension << " : enable\n";
+    }
+    bool floating = type == DataType::Float || type == DataType::Half || type == DataType::Double;
+    source << "#define T " << data_type_name(type) << "\n"
+           << "#define MULADD(x, y, z) " << (floating ? "fma(x, y, z)" : "((x) * (y) + (z))") << "\n"
+           << "#define FMA_CHAIN " << fmaChain << "\n"
+           << typed_kernel_body;
+    return source.str();
+}
+
+// IEEE half precision bit pattern; a distinct type so the templated host path can treat it apart
+// from integer cl_ushort data
+struct HalfBits {
+    cl_ushort bits = 0;
+    bool operator!=(const HalfBits& other) const { return bits != other.bits; }
+};
+
+// float -> half for the small, exactly representable values used here (truncating, no subnormals)
+static HalfBits float_to_half(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    HalfBits half;
+    uint32_t sign = (bits >> 16) & 0x8000;
+    int exponent = (int)((bits >> 23) & 0xff) - 127 + 15;
+    if (exponent <= 0) {
+        half.bits = (cl_ushort)sign;
+    } else if (exponent >= 31) {
+        half.bits = (cl_ushort)(sign | 0x7c00);
+    } else {
+        half.bits = (cl_ushort)(sign | ((uint32_t)exponent << 10) | ((bits & 0x7fffff) >> 13));
+    }
+    return half;
+}
+
+static float half_to_float(HalfBits half) {
+    uint32_t sign = (uint32_t)(half.bits & 0x8000) << 16;
+    uint32_t exponent = (half.bits >> 10) & 0x1f;
+    uint32_t mantissa = half.bits & 0x3ff;
+    uint32_t bits;
+    if (exponent == 0) {
+        // Zero or subnormal: value = mantissa * 2^-24
+        float value = (float)mantissa * (1.0f / 16777216.0f);
+        return sign ? -value : value;
+    } else if (exponent == 31) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Host-side conversions for the element types of the matrix
+template <typename T>
+struct HostType {
+    static T from_int(int value) { return (T)value; }
+    static double to_double(T value) { return (double)value; }
+};
+
+template <>
+struct HostType<HalfBits> {
+    static HalfBits from_int(int value) { return float_to_half((float)value); }
+    static double to_double(HalfBits value) { return half_to_float(value); }
+};
+
+// One type/kernel cell of the matrix
+struct TypedResult {
+    DataType type = DataType::Int;
+    bool fma = false;
+    size_t elementSize = 0;
+    PhaseStats kernel;
+    PhaseStats overall;
+    VerifyResult verify;
+};
+
+// Runs write A/B -> kernel -> read C over dataSize elements of T with A = 1 and B = 2, for
+// warmup + measured iterations, and checks every element of the last pass. The kernel runs one
+// work-item per element with a driver-chosen local size unless globalSize/localSize say otherwise.
+// A, B and C come from `pool` when it is not null.
+template <typename T>
+static bool run_typed_kernel(const cl::Context& context, const cl::CommandQueue& queue, const cl::Program& program,
+                             BufferPool* pool, const char* kernelName, int dataSize, int expected, const BenchmarkOptions& options,
+                             TypedResult& result, size_t globalSize = 0, size_t localSize = 0) {
+    cl_int err;
+    size_t bytes = sizeof(T) * dataSize;
+    std::vector<T, PageAlignedAllocator<T>> h_A(dataSize, HostType<T>::from_int(1));
+    std::vector<T, PageAlignedAllocator<T>> h_B(dataSize, HostType<T>::from_int(2));
+    std::vector<T, PageAlignedAllocator<T>> h_C(dataSize);
+
+    PipelineBuffers buffers;
+    if (!create_device_buffers(context, CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY,
+                               CL_MEM_WRITE_ONLY | CL_MEM_HOST_READ_ONLY, bytes, pool, buffers)) return false;
+    const cl::Buffer& d_A = buffers.d_A;
+    const cl::Buffer& d_B = buffers.d_B;
+    const cl::Buffer& d_C = buffers.d_C;
+
+    cl::Kernel kernel(program, kernelName, &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create kernel '" << kernelName << "'." << std::endl; return false; }
+    kernel.setArg(0, d_A);
+    kernel.setArg(1, d_B);
+    kernel.setArg(2, d_C);
+    kernel.setArg(3, dataSize);
+
+    std::vector<double> kernelSamples, overallSamples;
+    int totalIterations = options.warmupIterations + options.iterations;
+    for (int iter = 0; iter < totalIterations; ++iter) {
+        if (iter == totalIterations - 1) {
+            // Poison C before the verified pass, outside the timed window
+            queue.enqueueFillBuffer(d_C, (cl_uchar)0xff, 0, bytes);
+            queue.finish();
+            std::fill(reinterpret_cast<unsigned char*>(h_C.data()), reinterpret_cast<unsigned char*>(h_C.data()) + bytes, 0xff);
+        }
+        cl::Event writeA, writeB, kernelEvent;
+        auto start_overall = std::chrono::steady_clock::now();
+        err = queue.enqueueWriteBuffer(d_A, CL_FALSE, 0, bytes, h_A.data(), nullptr, &writeA);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to write buffer d_A." << std::endl; return false; }
+        err = queue.enqueueWriteBuffer(d_B, CL_FALSE, 0, bytes, h_B.data(), nullptr, &writeB);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to write buffer d_B." << std::endl; return false; }
+        std::vector<cl::Event> writeEvents = {writeA, writeB};
+        err = queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(globalSize ? globalSize : (size_t)dataSize),
+                                         localSize ? cl::NDRange(localSize) : cl::NullRange, &writeEvents, &kernelEvent);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to enqueue kernel '" << kernelName << "'." << std::endl; return false; }
+        std::vector<cl::Event> kernelDependencies = {kernelEvent};
+        err = queue.enqueueReadBuffer(d_C, CL_TRUE, 0, bytes, h_C.data(), &kernelDependencies);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to read buffer d_C." << std::endl; return false; }
+        queue.finish();
+        auto end_overall = std::chrono::steady_clock::now();
+        if (iter < options.warmupIterations) continue;
+        kernelSamples.push_back(event_ms(kernelEvent));
+        overallSamples.push_back(std::chrono::duration<double, std::milli>(end_overall - start_overall).count());
+    }
+    result.elementSize = sizeof(T);
+    result.kernel = compute_stats(kernelSamples);
+    result.overall = compute_stats(overallSamples);
+
+    T expectedValue = HostType<T>::from_int(expected);
+    result.verify = VerifyResult();
+    result.verify.checked = dataSize;
+    result.verify.correct = true;
+    for (int i = 0; i < dataSize; ++i) {
+        if (h_C[i] != expectedValue) {
+            result.verify.correct = false;
+            result.verify.firstMismatch = i;
+            result.verify.expected = expected;
+            result.verify.actual = (int)HostType<T>::to_double(h_C[i]);
+            break;
+        }
+    }
+    return true;
+}
+
+// Runs vecadd and the FMA chain for every selected element type on DATA_SIZE elements, showing
+// memory-bound (GB/s) and compute-bound (GOP/s) throughput per type
+void run_type_matrix(DeviceSession& session, const BenchmarkOptions& options, const DeviceIdentity& identity,
+                     std::vector<ResultRecord>& records) {
+    const cl::Device& device = session.device;
+    const cl::Context& context = session.context;
+    const cl::CommandQueue& queue = session.queue;
+    std::cout << "\n--- Data Type Matrix (" << DATA_SIZE << " elements, FMA chain " << options.fmaChain
+              << ", median of " << options.iterations << " iterations) ---" << std::endl;
+    std::cout << std::left << std::setw(8) << "Type" << std::setw(8) << "Kernel" << std::right
+              << std::setw(14) << "Kernel (ms)"
+              << std::setw(14) << "GB/s"
+              << std::setw(14) << "GOP/s"
+              << std::setw(15) << "Overall (ms)"
+              << "  Verification" << std::endl;
+
+    for (DataType type : options.dataTypes) {
+        if (!data_type_supported(device, type)) {
+            std::cout << std::left << std::setw(8) << data_type_name(type) << "skipped: device lacks "
+                      << data_type_extension(type) << std::endl;
+            continue;
+        }
+        cl::Program program;
+        BuildStats buildStats;
+        if (!session_program(session, typed_kernel_source(type, options.fmaChain), "", options, program, buildStats)) continue;
+
+        for (bool fma : {false, true}) {
+            TypedResult result;
+            result.type = type;
+            result.fma = fma;
+            const char* kernelName = fma ? "fma_chain_typed" : "vecadd_typed";
+            // A = 1, B = 2: vecadd gives 3; the chain gives 1 + 2 * FMA_CHAIN
+            int expected = fma ? 1 + 2 * options.fmaChain : 3;
+            bool ok = false;
+            switch (type) {
+            case DataType::Int: ok = run_typed_kernel<cl_int>(context, queue, program, &session.pool, kernelName, DATA_SIZE, expected, options, result); break;
+            case DataType::Long: ok = run_typed_kernel<cl_long>(context, queue, program, &session.pool, kernelName, DATA_SIZE, expected, options, result); break;
+            case DataType::Float: ok = run_typed_kernel<cl_float>(context, queue, program, &session.pool, kernelName, DATA_SIZE, expected, options, result); break;
+            case DataType::Half: ok = run_typed_kernel<HalfBits>(context, queue, program, &session.pool, kernelName, DATA_SIZE, expected, options, result); break;
+            case DataType::Double: ok = run_typed_kernel<cl_double>(context, queue, program, &session.pool, kernelName, DATA_SIZE, expected, options, result); break;
+            }
+            if (!ok) continue;
+
+            double bytes = 3.0 * (double)result.elementSize * DATA_SIZE;
+            // One add per element, or a multiply and an add per link of the chain
+            double ops = (double)DATA_SIZE * (fma ? 2.0 * options.fmaChain : 1.0);
+            std::cout << std::left << std::setw(8) << data_type_name(type) << std::setw(8) << (fma ? "fma" : "add") << std::right
+                      << std::setw(14) << result.kernel.median
+                      << std::setw(14) << gb_per_s(bytes, result.kernel.median)
+                      << std::setw(14) << gb_per_s(ops, result.kernel.median)
+                      << std::setw(15) << result.overall.median
+                      << "  " << (result.verify.correct ? "PASSED" : describe_verification(result.verify)) << std::endl;
+
+            const std::pair<const char*, const PhaseStats*> phases[] = {{"kernel", &result.kernel}, {"overall", &result.overall}};
+            for (const auto& phase : phases) {
+                ResultRecord record;
+                record.identity = identity;
+                record.test = "types";
+                record.kernel = std::string(data_type_name(type)) + (fma ? " fma" : " add");
+                record.elements = DATA_SIZE;
+                record.phase = phase.first;
+                record.bytes = bytes;
+                record.ops = ops;
+                record.stats = *phase.second;
+                record.verified = result.verify.correct;
+                records.push_back(record);
+            }
+        }
+    }
+}
+
+// Largest FMA count per element in the roofline sweep (powers of two from 1)
+static const int ROOFLINE_MAX_FMAS = 4096;
+
+// Float result of roofline_fma for A = 1, computed on the host with the same operation order
+static float roofline_expected(int fmas) {
+    float a = 1.0f, b = a * 0.5f;
+    float x0 = a, x1 = a + 1.0f, x2 = a + 2.0f, x3 = a + 3.0f;
+    int k = 0;
+    for (; k + 4 <= fmas; k += 4) {
+        x0 = std::fma(x0, a, b);
+        x1 = std::fma(x1, a, b);
+        x2 = std::fma(x2, a, b);
+        x3 = std::fma(x3, a, b);
+    }
+    for (; k < fmas; ++k) x0 = std::fma(x0, a, b);
+    return x0 + x1 + x2 + x3;
+}
+
+// Sweeps roofline_fma from 1 to ROOFLINE_MAX_FMAS multiply-adds per element over
+// options.rooflineBytes of input, tabulates achieved GFLOP/s against arithmetic intensity
+// (FLOP per byte of DRAM traffic) and derives the ridge point where the device turns compute-bound
+void run_roofline(const cl::Context& context, const cl::CommandQueue& queue, const cl::Program& program,
+                  BufferPool* pool, const BenchmarkOptions& options, const DeviceIdentity& identity,
+                  std::vector<ResultRecord>& records) {
+    cl_int err;
+    int elements = (int)std::min<size_t>(options.rooflineBytes / sizeof(int), INT_MAX);
+    size_t bytes = sizeof(int) * elements;
+
+    // Same page-aligned host vectors and copy-strategy buffers as the vecadd pipeline; A is uploaded
+    // once and only kernel time is measured
+    HostVector h_A(elements, 1);
+    HostVector h_B(0);
+    HostVector h_C(elements);
+    PipelineBuffers buffers;
+    if (!create_pipeline_buffers(context, BufferStrategy::Copy, bytes, h_A, h_B, h_C, buffers, pool)) return;
+    err = queue.enqueueWriteBuffer(buffers.d_A, CL_TRUE, 0, bytes, h_A.data());
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to write buffer d_A." << std::endl; return; }
+
+    cl::Kernel kernel(program, "roofline_fma", &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create kernel 'roofline_fma'." << std::endl; return; }
+    kernel.setArg(0, buffers.d_A);
+    kernel.setArg(1, buffers.d_C);
+    kernel.setArg(2, elements);
+
+    struct Point { int fmas; double intensity; double gflops; double gbps; bool correct; };
+    std::vector<Point> points;
+    for (int fmas = 1; fmas <= ROOFLINE_MAX_FMAS; fmas *= 2) {
+        kernel.setArg(3, fmas);
+        std::vector<double> samples;
+        for (int iter = 0; iter < options.warmupIterations + options.iterations; ++iter) {
+            cl::Event event;
+            err = queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(elements), cl::NullRange, nullptr, &event);
+            if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to enqueue kernel 'roofline_fma'." << std::endl; return; }
+            event.wait();
+            if (iter >= options.warmupIterations) samples.push_back(event_ms(event));
+        }
+
+        // Every element must hold the bit pattern of the host-computed float
+        err = queue.enqueueReadBuffer(buffers.d_C, CL_TRUE, 0, bytes, h_C.data());
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to read buffer d_C." << std::endl; return; }
+        float expectedValue = roofline_expected(fmas);
+        int expectedBits;
+        std::memcpy(&expectedBits, &expectedValue, sizeof(expectedBits));
+        bool correct = std::all_of(h_C.begin(), h_C.end(), [&](int bits) { return bits == expectedBits; });
+
+        ResultRecord record;
+        record.identity = identity;
+        record.test = "roofline";
+        record.kernel = "fma x" + std::to_string(fmas);
+        record.elements = elements;
+        record.phase = "kernel";
+        record.bytes = 2.0 * (double)bytes; // One 4-byte load and one 4-byte store per element
+        record.ops = 2.0 * fmas * (double)elements;
+        record.stats = compute_stats(samples);
+        record.verified = correct;
+        records.push_back(record);
+
+        double flops = record.ops;
+        points.push_back({fmas, flops / record.bytes, gb_per_s(flops, record.stats.median),
+                          gb_per_s(record.bytes, record.stats.median), correct});
+    }
+
+    // The roofs are the best rates observed: bandwidth from the memory-bound end, FLOP/s overall
+    double peakGflops = 0.0, peakGbps = 0.0;
+    for (const auto& point : points) {
+        peakGflops = std::max(peakGflops, point.gflops);
+        peakGbps = std::max(peakGbps, point.gbps);
+    }
+    double ridge = peakGbps > 0.0 ? peakGflops / peakGbps : 0.0;
+
+    std::cout << "\n--- Roofline (" << bytes / (1024.0 * 1024.0) << " MB, median of " << options.iterations
+              << " iterations) ---" << std::endl;
+    std::cout << std::setw(10) << "FMAs/elem" << std::setw(14) << "FLOP/byte" << std::setw(12) << "GFLOP/s"
+              << std::setw(10) << "GB/s" << "  " << std::left << std::setw(10) << "Bound" << "% of peak GFLOP/s"
+              << std::right << std::endl;
+    for (const auto& point : points) {
+        const int BAR_WIDTH = 40;
+        int bar = peakGflops > 0.0 ? (int)std::lround(point.gflops / peakGflops * BAR_WIDTH) : 0;
+        std::cout << std::setw(10) << point.fmas
+                  << std::setw(14) << point.intensity
+                  << std::setw(12) << point.gflops
+                  << std::setw(10) << point.gbps << "  " << std::left
+                  << std::setw(10) << (point.intensity < ridge ? "memory" : "compute")
+                  << std::string(bar, '#') << std::right
+                  << (point.correct ? "" : "  (verification FAILED)") << std::endl;
+    }
+    std::cout << "Peak: " << peakGflops << " GFLOP/s, " << peakGbps << " GB/s; ridge point at "
+              << ridge << " FLOP/byte" << std::endl;
+    std::cout << "Kernels below " << ridge << " FLOP/byte are limited by memory traffic on this device; above it, by compute."
+              << std::endl;
+}
+
+// Largest number of the given commands executing at the same time, from their START/END ranges
+static int max_concurrent(const std::vector<cl::Event>& events) {
+    std::vector<std::pair<cl_ulong, int>> edges;
+    for (const auto& event : events) {
+        cl_ulong start = 0, end = 0;
+        event.getProfilingInfo(CL_PROFILING_COMMAND_START, &start);
+        event.getProfilingInfo(CL_PROFILING_COMMAND_END, &end);
+        edges.push_back({start, 1});
+        edges.push_back({end, -1});
+    }
+    // Ends sort before starts at the same timestamp, so back-to-back commands do not count as overlapping
+    std::sort(edges.begin(), edges.end());
+    int running = 0, peak = 0;
+    for (const auto& edge : edges) {
+        running += edge.second;
+        peak = std::max(peak, running);
+    }
+    return peak;
+}
+
+// Buffers and kernel of one independent vecadd stream in the concurrency benchmark
+struct ConcurrentStream {
+    cl::Buffer d_A, d_B, d_C;
+    cl::Kernel kernel;
+};
+
+// Enqueues write -> vecadd -> read for every stream, stream s on queues[s % queues.size()], and
+// waits for all of them. Ordering inside a stream comes from events so out-of-order queues are safe.
+static bool run_concurrent_pass(const std::vector<cl::CommandQueue>& queues, std::vector<ConcurrentStream>& streams,
+                                const HostVector& h_A, const HostVector& h_B, HostVector& h_C, int elements,
+                                std::vector<TraceCommand>& commands, std::vector<cl::Event>& kernelEvents,
+                                double& overallMs) {
+    cl_int err;
+    size_t bytes = sizeof(int) * elements;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t s = 0; s < streams.size(); ++s) {
+        const cl::CommandQueue& queue = queues[s % queues.size()];
+        size_t offset = s * (size_t)elements;
+        std::string stream = "stream " + std::to_string(s) + " ";
+        cl::Event writeEventA, writeEventB, kernelEvent, readEventC;
+        err = queue.enqueueWriteBuffer(streams[s].d_A, CL_FALSE, 0, bytes, h_A.data() + offset, nullptr, &writeEventA);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to write " << stream << "A." << std::endl; return false; }
+        err = queue.enqueueWriteBuffer(streams[s].d_B, CL_FALSE, 0, bytes, h_B.data() + offset, nullptr, &writeEventB);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to write " << stream << "B." << std::endl; return false; }
+        std::vector<cl::Event> writeEvents = {writeEventA, writeEventB};
+        err = queue.enqueueNDRangeKernel(streams[s].kernel, cl::NullRange, cl::NDRange(elements), cl::NullRange, &writeEvents, &kernelEvent);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to enqueue kernel for " << stream << "." << std::endl; return false; }
+        std::vector<cl::Event> kernelDependencies = {kernelEvent};
+        err = queue.enqueueReadBuffer(streams[s].d_C, CL_FALSE, 0, bytes, h_C.data() + offset, &kernelDependencies, &readEventC);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to read " << stream << "C." << std::endl; return false; }
+        // Submit each stream right away so the device can start on it while the next one is enqueued
+        queue.flush();
+
+        commands.push_back({&queue, stream + "write A", writeEventA});
+        commands.push_back({&queue, stream + "write B", writeEventB});
+        commands.push_back({&queue, stream + "vecadd", kernelEvent});
+        commands.push_back({&queue, stream + "read C", readEventC});
+        kernelEvents.push_back(kernelEvent);
+    }
+    for (const auto& queue : queues) {
+        err = queue.finish();
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to finish concurrency queue." << std::endl; return false; }
+    }
+    overallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+// Runs options.concurrencyStreams independent vecadd streams through 1, 2, 4, ... N in-order
+// queues and through one out-of-order queue, and reports aggregate throughput and whether kernels
+// of different streams actually overlapped on the device
+void run_concurrency(const cl::Device& device, const cl::Context& context, const cl::Program& program,
+                     TraceLog* trace, const BenchmarkOptions& options, const DeviceIdentity& identity,
+                     std::vector<ResultRecord>& records) {
+    cl_int err;
+    int streamCount = options.concurrencyStreams;
+    int elements = options.concurrencyElements;
+    size_t bytes = sizeof(int) * elements;
+    size_t totalElements = (size_t)streamCount * elements;
+
+    HostVector h_A(totalElements, 1);
+    HostVector h_B(totalElements, 2);
+    HostVector h_C(totalElements);
+    std::vector<ConcurrentStream> streams(streamCount);
+    for (auto& stream : streams) {
+        stream.d_A = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY, bytes, nullptr, &err);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create stream buffer." << std::endl; return; }
+        stream.d_B = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY, bytes, nullptr, &err);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create stream buffer." << std::endl; return; }
+        stream.d_C = cl::Buffer(context, CL_MEM_WRITE_ONLY | CL_MEM_HOST_READ_ONLY, bytes, nullptr, &err);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create stream buffer." << std::endl; return; }
+        stream.kernel = cl::Kernel(program, "vecadd", &err);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create kernel 'vecadd'." << std::endl; return; }
+        stream.kernel.setArg(0, stream.d_A);
+        stream.kernel.setArg(1, stream.d_B);
+        stream.kernel.setArg(2, stream.d_C);
+        stream.kernel.setArg(3, elements);
+    }
+
+    // In-order queue counts double up to the stream count; 0 stands for the single out-of-order queue
+    std::vector<int> queueCounts;
+    for (int count = 1; count < streamCount; count *= 2) queueCounts.push_back(count);
+    queueCounts.push_back(streamCount);
+    queueCounts.push_back(0);
+
+    std::cout << "\n--- Queue Concurrency (" << streamCount << " streams of " << bytes / (1024.0 * 1024.0)
+              << " MB, median of " << options.iterations << " iterations) ---" << std::endl;
+    std::cout << std::left << std::setw(16) << "Schedule" << std::right
+              << std::setw(14) << "Median (ms)"
+              << std::setw(12) << "GB/s"
+              << std::setw(16) << "Kernel overlap"
+              << std::setw(13) << "Max kernels"
+              << std::setw(14) << "Max commands"
+              << "  Verification" << std::endl;
+
+    double totalBytes = 3.0 * sizeof(int) * (double)totalElements;
+    double bestGbps = 0.0;
+    int maxKernelsSeen = 0;
+    std::vector<std::pair<int, double>> inOrderRates; // (queues, GB/s)
+    for (int queueCount : queueCounts) {
+        bool outOfOrder = queueCount == 0;
+        std::string schedule = outOfOrder ? std::string("out-of-order") : "in-order x" + std::to_string(queueCount);
+        cl_command_queue_properties props = CL_QUEUE_PROFILING_ENABLE;
+        if (outOfOrder) props |= CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE;
+        std::vector<cl::CommandQueue> queues;
+        for (int i = 0; i < std::max(queueCount, 1); ++i) {
+            queues.emplace_back(context, device, props, &err);
+            if (err != CL_SUCCESS) break;
+            trace_queue(trace, device, queues.back(),
+                        outOfOrder ? std::string("concurrency out-of-order queue") : "concurrency queue " + std::to_string(i));
+        }
+        if (err != CL_SUCCESS) {
+            print_cl_error(err);
+            std::cout << std::left << std::setw(16) << schedule << std::right << "  skipped: queue creation failed"
+                      << (outOfOrder ? " (out-of-order not supported?)" : "") << std::endl;
+            continue;
+        }
+
+        std::vector<double> samples, overlapSamples;
+        int maxKernels = 0, maxCommands = 0;
+        int totalIterations = options.warmupIterations + options.iterations;
+        for (int iter = 0; iter < totalIterations; ++iter) {
+            if (iter == totalIterations - 1) {
+                // Poison every C before the verified pass, outside the timed window
+                for (auto& stream : streams) queues[0].enqueueFillBuffer(stream.d_C, VERIFY_POISON, 0, bytes);
+                queues[0].finish();
+                std::fill(h_C.begin(), h_C.end(), VERIFY_POISON);
+            }
+            std::vector<TraceCommand> commands;
+            std::vector<cl::Event> kernelEvents;
+            double ms = 0.0;
+            if (!run_concurrent_pass(queues, streams, h_A, h_B, h_C, elements, commands, kernelEvents, ms)) return;
+            trace_commands(trace, commands, steady_ns());
+            if (iter < options.warmupIterations) continue;
+
+            std::vector<cl::Event> allEvents;
+            for (const auto& command : commands) allEvents.push_back(command.event);
+            // Summed kernel time over the time at least one kernel ran: 1 = serialised, N = N at once
+            double kernelMs = 0.0;
+            for (const auto& event : kernelEvents) kernelMs += event_ms(event);
+            DeviceSpan span = device_span(kernelEvents);
+            overlapSamples.push_back(span.busyNs > 0.0 ? kernelMs * 1e6 / span.busyNs : 0.0);
+            maxKernels = std::max(maxKernels, max_concurrent(kernelEvents));
+            maxCommands = std::max(maxCommands, max_concurrent(allEvents));
+            samples.push_back(ms);
+        }
+        VerifyResult verify = verify_vecadd(h_A.data(), h_B.data(), h_C.data(), totalElements);
+
+        ResultRecord record;
+        record.identity = identity;
+        record.test = "concurrency";
+        record.strategy = schedule;
+        record.kernel = "vecadd";
+        record.elements = (long long)totalElements;
+        record.phase = "overall";
+        record.bytes = totalBytes;
+        record.stats = compute_stats(samples);
+        record.verified = verify.correct;
+        records.push_back(record);
+
+        double gbps = gb_per_s(totalBytes, record.stats.median);
+        bestGbps = std::max(bestGbps, gbps);
+        maxKernelsSeen = std::max(maxKernelsSeen, maxKernels);
+        if (!outOfOrder) inOrderRates.push_back({queueCount, gbps});
+        std::cout << std::left << std::setw(16) << schedule << std::right
+                  << std::setw(14) << record.stats.median
+                  << std::setw(12) << gbps
+                  << std::setw(15) << compute_stats(overlapSamples).median << "x"
+                  << std::setw(13) << maxKernels
+                  << std::setw(14) << maxCommands
+                  << "  " << (verify.correct ? "PASSED" : describe_verification(verify)) << std::endl;
+    }
+
+    if (maxKernelsSeen > 1) {
+        std::cout << "Kernels of different streams ran concurrently (up to " << maxKernelsSeen << " at once)." << std::endl;
+    } else {
+        std::cout << "The device never ran two kernels at once; extra queues can only overlap transfers with compute." << std::endl;
+    }
+    // The fewest in-order queues that get within levelOffRatio of the best schedule
+    for (const auto& rate : inOrderRates) {
+        if (rate.second >= bestGbps * options.levelOffRatio) {
+            std::cout << rate.first << " in-order queue" << (rate.first == 1 ? "" : "s") << " reach "
+                      << options.levelOffRatio * 100.0 << "% of the best throughput (" << rate.second << " of "
+                      << bestGbps << " GB/s)" << std::endl;
+            break;
+        }
+    }
+}
+
+// Reads `buffer` back and checks that every element equals `value`
+static bool buffer_holds(const cl::CommandQueue& queue, const cl::Buffer& buffer, size_t bytes, int value) {
+    std::vector<int> host(bytes / sizeof(int));
+    if (queue.enqueueReadBuffer(buffer, CL_TRUE, 0, bytes, host.data()) != CL_SUCCESS) return false;
+    return std::all_of(host.begin(), host.end(), [&](int element) { return element == value; });
+}
+
+// Times enqueueCopyBuffer between two buffers of one device and enqueueFillBuffer, over
+// options.transferBytes, and reports them like the pipeline's transfer phases
+void run_device_copies(const cl::CommandQueue& queue, BufferPool& pool, TraceLog* trace, const DevicePeaks& peaks,
+                       const BenchmarkOptions& options, const DeviceIdentity& identity, std::vector<ResultRecord>& records) {
+    cl_int err;
+    size_t bytes = options.transferBytes / sizeof(int) * sizeof(int);
+    cl::Buffer d_src, d_dst;
+    err = pool.acquire(CL_MEM_READ_WRITE, bytes, d_src);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create copy source buffer." << std::endl; return; }
+    err = pool.acquire(CL_MEM_READ_WRITE, bytes, d_dst);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create copy destination buffer." << std::endl; return; }
+
+    // Each pass writes a new value so a copy or fill that silently does nothing cannot pass
+    std::vector<double> copySamples, fillSamples;
+    bool copyCorrect = true, fillCorrect = true;
+    int totalIterations = options.warmupIterations + options.iterations;
+    for (int iter = 0; iter < totalIterations; ++iter) {
+        int value = iter + 1;
+        err = queue.enqueueFillBuffer(d_src, value, 0, bytes);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to fill copy source buffer." << std::endl; return; }
+        queue.finish();
+
+        cl::Event copyEvent, fillEvent;
+        err = queue.enqueueCopyBuffer(d_src, d_dst, 0, 0, bytes, nullptr, &copyEvent);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to copy buffer." << std::endl; return; }
+        queue.finish();
+        if (iter == totalIterations - 1) copyCorrect = buffer_holds(queue, d_dst, bytes, value);
+
+        err = queue.enqueueFillBuffer(d_dst, -value, 0, bytes, nullptr, &fillEvent);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to fill buffer." << std::endl; return; }
+        queue.finish();
+        if (iter == totalIterations - 1) fillCorrect = buffer_holds(queue, d_dst, bytes, -value);
+
+        trace_commands(trace, {{&queue, "copy D2D", copyEvent}, {&queue, "fill", fillEvent}}, steady_ns());
+        if (iter < options.warmupIterations) continue;
+        copySamples.push_back(event_ms(copyEvent));
+        fillSamples.push_back(event_ms(fillEvent));
+    }
+    pool.release(CL_MEM_READ_WRITE, bytes, d_src);
+    pool.release(CL_MEM_READ_WRITE, bytes, d_dst);
+
+    ResultRecord record;
+    record.identity = identity;
+    record.test = "transfer";
+    record.elements = (long long)(bytes / sizeof(int));
+    record.phase = "kernel";
+    // A copy reads and writes every byte; a fill only writes
+    record.kernel = "copy_d2d";
+    record.bytes = 2.0 * (double)bytes;
+    record.stats = compute_stats(copySamples);
+    record.verified = copyCorrect;
+    records.push_back(record);
+    PhaseStats copy = record.stats;
+    record.kernel = "fill";
+    record.bytes = (double)bytes;
+    record.stats = compute_stats(fillSamples);
+    record.verified = fillCorrect;
+    records.push_back(record);
+    PhaseStats fill = record.stats;
+
+    std::cout << "\n--- Device Copies (" << bytes / (1024.0 * 1024.0) << " MB, median of " << options.iterations
+              << " iterations) ---" << std::endl;
+    std::cout << std::left << std::setw(28) << "Phase (ms)" << std::right
+              << std::setw(11) << "min"
+              << std::setw(11) << "median"
+              << std::setw(11) << "p95"
+              << std::setw(11) << "p99"
+              << std::setw(11) << "stddev"
+              << std::setw(10) << "cv" << std::endl;
+    print_phase_stats("Copy (Device -> Device):", copy);
+    print_phase_stats("Fill (Device):", fill);
+    std::cout << "Copy bandwidth:           " << format_rate(gb_per_s(2.0 * (double)bytes, copy.median), peaks.memoryGBps)
+              << " (read + write), " << gb_per_s((double)bytes, copy.median) << " GB/s copied" << std::endl;
+    std::cout << "Fill bandwidth:           " << format_rate(gb_per_s((double)bytes, fill.median), peaks.memoryGBps) << std::endl;
+    std::cout << "Result verification: copy " << (copyCorrect ? "PASSED" : "FAILED")
+              << ", fill " << (fillCorrect ? "PASSED" : "FAILED") << std::endl;
+}
+
+// Out-of-core inputs are generated chunk by chunk: A depends on the global element index so a
+// chunk written to the wrong place fails verification, B is constant
+static int out_of_core_a(size_t index) { return (int)(index % 16777213); }
+static const int OUT_OF_CORE_B = 2;
+
+// Peak resident set size of this process in MB, or -1 where it cannot be queried
+static double peak_rss_mb() {
+#ifdef __linux__
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) return usage.ru_maxrss / 1024.0; // KB on Linux
+#endif
+    return -1.0;
+}
+
+// One in-flight chunk of the out-of-core stream: pinned host staging and device buffers, reused
+// by every slotCount-th chunk
+struct OutOfCoreSlot {
+    PinnedHostBuffer hostA, hostB, hostC;
+    cl::Buffer d_A, d_B, d_C;
+    cl::Kernel kernel;
+    cl::Event writeEventA, writeEventB, kernelEvent, readEventC;
+    size_t offset = 0;
+    size_t count = 0;
+    bool inFlight = false;
+};
+
+// Streams vecadd over inputs larger than device memory through a fixed ring of chunk buffers.
+// Inputs are generated and results checked on the host while other chunks are on the device, so
+// neither host nor device memory grows with the dataset.
+void run_out_of_core(const cl::Device& device, const cl::Context& context, const cl::Program& program,
+                     TraceLog* trace, const BenchmarkOptions& options, const DeviceIdentity& identity,
+                     std::vector<ResultRecord>& records) {
+    cl_int err;
+    cl_ulong globalMemBytes = 0;
+    device.getInfo(CL_DEVICE_GLOBAL_MEM_SIZE, &globalMemBytes);
+    size_t totalBytes = options.outOfCoreBytes ? options.outOfCoreBytes : (size_t)(globalMemBytes + globalMemBytes / 2);
+    size_t totalElements = totalBytes / sizeof(int);
+    size_t chunkElements = std::min(std::min(options.outOfCoreChunkBytes / sizeof(int), (size_t)INT_MAX), totalElements);
+    if (chunkElements == 0) {
+        std::cerr << "Out-of-core input is empty." << std::endl;
+        return;
+    }
+    size_t chunkBytes = sizeof(int) * chunkElements;
+    size_t chunkCount = (totalElements + chunkElements - 1) / chunkElements;
+    size_t slotCount = std::min((size_t)options.outOfCoreSlots, chunkCount);
+
+    // In-order queues per stage, as in the streaming pipeline
+    std::vector<cl::CommandQueue> stageQueues;
+    const char* stageNames[] = {"out-of-core upload", "out-of-core compute", "out-of-core download"};
+    for (const char* stage : stageNames) {
+        stageQueues.emplace_back(context, device, CL_QUEUE_PROFILING_ENABLE, &err);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create out-of-core command queue." << std::endl; return; }
+        trace_queue(trace, device, stageQueues.back(), stage);
+    }
+    const cl::CommandQueue& uploadQueue = stageQueues[0];
+    const cl::CommandQueue& computeQueue = stageQueues[1];
+    const cl::CommandQueue& downloadQueue = stageQueues[2];
+
+    std::vector<OutOfCoreSlot> slots(slotCount);
+    for (auto& slot : slots) {
+        if (!create_pinned_host_buffer(context, uploadQueue, chunkBytes, slot.hostA) ||
+            !create_pinned_host_buffer(context, uploadQueue, chunkBytes, slot.hostB) ||
+            !create_pinned_host_buffer(context, downloadQueue, chunkBytes, slot.hostC)) return;
+        slot.d_A = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY, chunkBytes, nullptr, &err);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create out-of-core buffer." << std::endl; return; }
+        slot.d_B = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY, chunkBytes, nullptr, &err);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create out-of-core buffer." << std::endl; return; }
+        slot.d_C = cl::Buffer(context, CL_MEM_WRITE_ONLY | CL_MEM_HOST_READ_ONLY, chunkBytes, nullptr, &err);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create out-of-core buffer." << std::endl; return; }
+        slot.kernel = cl::Kernel(program, "vecadd", &err);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create kernel 'vecadd'." << std::endl; return; }
+        slot.kernel.setArg(0, slot.d_A);
+        slot.kernel.setArg(1, slot.d_B);
+        slot.kernel.setArg(2, slot.d_C);
+    }
+
+    VerifyResult verify;
+    verify.correct = true;
+    double hostMs = 0.0; // Generating inputs and checking results
+    std::vector<double> chunkIntervals;
+    auto start = std::chrono::steady_clock::now();
+    auto lastDone = start;
+
+    // Waits for the slot's chunk, records when it completed and checks its results
+    auto retire = [&](OutOfCoreSlot& slot) {
+        err = slot.readEventC.wait();
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Out-of-core chunk failed." << std::endl; return false; }
+        auto done = std::chrono::steady_clock::now();
+        chunkIntervals.push_back(std::chrono::duration<double, std::milli>(done - lastDone).count());
+        lastDone = done;
+        trace_commands(trace, {{&uploadQueue, "write A", slot.writeEventA}, {&uploadQueue, "write B", slot.writeEventB},
+                               {&computeQueue, "vecadd", slot.kernelEvent}, {&downloadQueue, "read C", slot.readEventC}},
+                       steady_ns(done));
+
+        for (size_t j = 0; j < slot.count; ++j) {
+            int expected = out_of_core_a(slot.offset + j) + OUT_OF_CORE_B;
+            if (slot.hostC.ptr[j] != expected && verify.correct) {
+                verify.correct = false;
+                verify.firstMismatch = slot.offset + j;
+                verify.expected = expected;
+                verify.actual = slot.hostC.ptr[j];
+            }
+        }
+        verify.checked += slot.count;
+        slot.inFlight = false;
+        hostMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - done).count();
+        return true;
+    };
+
+    for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+        OutOfCoreSlot& slot = slots[chunk % slotCount];
+        if (slot.inFlight && !retire(slot)) return;
+
+        slot.offset = chunk * chunkElements;
+        slot.count = std::min(chunkElements, totalElements - slot.offset);
+        size_t bytes = sizeof(int) * slot.count;
+        auto generateStart = std::chrono::steady_clock::now();
+        for (size_t j = 0; j < slot.count; ++j) {
+            slot.hostA.ptr[j] = out_of_core_a(slot.offset + j);
+            slot.hostB.ptr[j] = OUT_OF_CORE_B;
+        }
+        std::fill(slot.hostC.ptr, slot.hostC.ptr + slot.count, VERIFY_POISON);
+        hostMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - generateStart).count();
+
+        err = uploadQueue.enqueueWriteBuffer(slot.d_A, CL_FALSE, 0, bytes, slot.hostA.ptr, nullptr, &slot.writeEventA);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to write out-of-core chunk " << chunk << "." << std::endl; return; }
+        err = uploadQueue.enqueueWriteBuffer(slot.d_B, CL_FALSE, 0, bytes, slot.hostB.ptr, nullptr, &slot.writeEventB);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to write out-of-core chunk " << chunk << "." << std::endl; return; }
+        std::vector<cl::Event> writeEvents = {slot.writeEventA, slot.writeEventB};
+        slot.kernel.setArg(3, (int)slot.count);
+        err = computeQueue.enqueueNDRangeKernel(slot.kernel, cl::NullRange, cl::NDRange(slot.count), cl::NullRange, &writeEvents, &slot.kernelEvent);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to enqueue kernel for out-of-core chunk " << chunk << "." << std::endl; return; }
+        std::vector<cl::Event> kernelDependencies = {slot.kernelEvent};
+        err = downloadQueue.enqueueReadBuffer(slot.d_C, CL_FALSE, 0, bytes, slot.hostC.ptr, &kernelDependencies, &slot.readEventC);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to read out-of-core chunk " << chunk << "." << std::endl; return; }
+        uploadQueue.flush();
+        computeQueue.flush();
+        downloadQueue.flush();
+        slot.inFlight = true;
+    }
+    // Drain the ring in submission order
+    for (size_t chunk = chunkCount; chunk < chunkCount + slotCount; ++chunk) {
+        OutOfCoreSlot& slot = slots[chunk % slotCount];
+        if (slot.inFlight && !retire(slot)) return;
+    }
+    double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    double streamedBytes = 3.0 * sizeof(int) * (double)totalElements; // A and B in, C out
+    double workingSetBytes = 3.0 * (double)chunkBytes * (double)slotCount;
+    PhaseStats intervals = compute_stats(chunkIntervals);
+    double rssMb = peak_rss_mb();
+
+    ResultRecord record;
+    record.identity = identity;
+    record.test = "out_of_core";
+    record.kernel = "vecadd";
+    record.elements = (long long)totalElements;
+    record.phase = "overall";
+    record.bytes = streamedBytes;
+    record.stats = compute_stats({totalMs});
+    record.verified = verify.correct;
+    records.push_back(record);
+    record.phase = "chunk";
+    record.bytes = 3.0 * (double)chunkBytes;
+    record.stats = intervals;
+    records.push_back(record);
+
+    double mb = 1024.0 * 1024.0;
+    std::cout << "\n--- Out-of-Core Streaming (" << totalBytes / (mb * 1024.0) << " GB per input, "
+              << (globalMemBytes ? (double)totalBytes / globalMemBytes : 0.0) << "x device memory, " << chunkCount
+              << " chunks of " << chunkBytes / mb << " MB, " << slotCount << " in flight) ---" << std::endl;
+    if ((cl_ulong)totalBytes <= globalMemBytes) {
+        std::cout << "Note: the input fits in CL_DEVICE_GLOBAL_MEM_SIZE; raise --out-of-core to exceed it." << std::endl;
+    }
+    std::cout << "End-to-end:               " << totalMs / 1000.0 << " s, " << gb_per_s(streamedBytes, totalMs)
+              << " GB/s (A + B in, C out)" << std::endl;
+    std::cout << "Sustained per chunk:      " << gb_per_s(3.0 * (double)chunkBytes, intervals.median) << " GB/s (median of "
+              << intervals.count << " completion intervals, " << intervals.median << " ms, cv "
+              << intervals.cv * 100.0 << "%)" << std::endl;
+    std::cout << "Host generate + check:    " << hostMs << " ms (" << (totalMs > 0.0 ? hostMs / totalMs * 100.0 : 0.0)
+              << "% of wall time)" << std::endl;
+    std::cout << "Peak device memory:       " << workingSetBytes / mb << " MB working set ("
+              << (globalMemBytes ? workingSetBytes / globalMemBytes * 100.0 : 0.0) << "% of device memory)" << std::endl;
+    std::cout << "Peak host memory:         " << workingSetBytes / mb << " MB pinned staging";
+    if (rssMb >= 0.0) std::cout << ", " << rssMb << " MB process peak RSS";
+    std::cout << std::endl;
+    std::cout << "Result verification: " << describe_verification(verify) << std::endl;
+}
+
+#ifdef __linux__
+// An mmap()ed region, either a file mapping or anonymous memory; unmapped on destruction
+struct MappedRegion {
+    void* data = nullptr;
+    size_t bytes = 0;
+    std::string advice; // madvise hints given to the mapping, with the ones the kernel refused marked
+
+    MappedRegion() = default;
+    MappedRegion(const MappedRegion&) = delete;
+    MappedRegion& operator=(const MappedRegion&) = delete;
+    ~MappedRegion() {
+        if (data) munmap(data, bytes);
+    }
+    int* ints() const { return static_cast<int*>(data); }
+};
+
+// madvise() takes one advice value per call; records in region.advice whether this one applied
+static void advise_region(MappedRegion& region, int advice, const char* name) {
+    bool applied = madvise(region.data, region.bytes, advice) == 0;
+    if (!region.advice.empty()) region.advice += ", ";
+    region.advice += name;
+    if (!applied) region.advice += std::string(" (refused: ") + std::strerror(errno) + ")";
+}
+
+// Maps the first `bytes` of `path`. Outputs are shared mappings so stores reach the file; inputs are
+// private so a runtime writing through CL_MEM_USE_HOST_PTR can never modify them. The kernel is
+// told how the mapping will be read, and asked for huge pages where the filesystem supports them.
+static bool map_file(const std::string& path, size_t bytes, bool output, MappedRegion& region) {
+    int fd = open(path.c_str(), output ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to open " << path << std::endl;
+        return false;
+    }
+    if (output && ftruncate(fd, (off_t)bytes) != 0) {
+        std::cerr << "Failed to size " << path << std::endl;
+        close(fd);
+        return false;
+    }
+    void* data = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, output ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps the file referenced
+    if (data == MAP_FAILED) {
+        std::cerr << "Failed to mmap " << path << std::endl;
+        return false;
+    }
+    region.data = data;
+    region.bytes = bytes;
+    advise_region(region, MADV_SEQUENTIAL, "MADV_SEQUENTIAL");
+    if (!output) advise_region(region, MADV_WILLNEED, "MADV_WILLNEED");
+#ifdef MADV_HUGEPAGE
+    // Only tmpfs and some filesystems back file mappings with huge pages; most refuse with EINVAL
+    advise_region(region, MADV_HUGEPAGE, "MADV_HUGEPAGE");
+#endif
+    return true;
+}
+
+// Anonymous staging memory, backed by transparent huge pages where the kernel allows
+static bool map_anonymous(size_t bytes, MappedRegion& region) {
+    void* data = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+        std::cerr << "Failed to allocate " << bytes << " bytes of staging memory." << std::endl;
+        return false;
+    }
+    region.data = data;
+    region.bytes = bytes;
+#ifdef MADV_HUGEPAGE
+    advise_region(region, MADV_HUGEPAGE, "MADV_HUGEPAGE");
+#endif
+    return true;
+}
+
+// read() / write() until all `bytes` are transferred; false on error or end of file
+static bool read_full(int fd, void* data, size_t bytes) {
+    char* out = static_cast<char*>(data);
+    while (bytes > 0) {
+        ssize_t got = read(fd, out, bytes);
+        if (got <= 0) return false;
+        out += got;
+        bytes -= (size_t)got;
+    }
+    return true;
+}
+
+static bool write_full(int fd, const void* data, size_t bytes) {
+    const char* in = static_cast<const char*>(data);
+    while (bytes > 0) {
+        ssize_t put = write(fd, in, bytes);
+        if (put <= 0) return false;
+        in += put;
+        bytes -= (size_t)put;
+    }
+    return true;
+}
+
+// Size of `path` in bytes, or 0 if it does not exist
+static size_t file_size(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 ? (size_t)info.st_size : 0;
+}
+
+// Writes `bytes` of `value` to `path`, replacing its contents
+static bool write_constant_file(const std::string& path, size_t bytes, int value) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to create " << path << std::endl;
+        return false;
+    }
+    std::vector<int> block(1024 * 1024 / sizeof(int), value);
+    bool ok = true;
+    for (size_t done = 0; ok && done < bytes; done += block.size() * sizeof(int)) {
+        ok = write_full(fd, block.data(), std::min(bytes - done, block.size() * sizeof(int)));
+    }
+    close(fd);
+    if (!ok) std::cerr << "Failed to write " << path << std::endl;
+    return ok;
+}
+
+// Drops the file's clean pages from the page cache so the next pass reads from the device
+static void evict_file(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+#endif
+
+// Ways of getting file data into and out of the vecadd pipeline compared by --file-io
+enum class FilePath {
+    ReadWrite,     // read() into huge-page staging, copy to device buffers, read back, write()
+    MmapCopy,      // mmap the files, enqueueWriteBuffer / enqueueReadBuffer straight from the mappings
+    MmapHostPtr,   // mmap the files and wrap the mappings in CL_MEM_USE_HOST_PTR buffers
+};
+
+static const FilePath ALL_FILE_PATHS[] = {FilePath::ReadWrite, FilePath::MmapCopy, FilePath::MmapHostPtr};
+
+static const char* file_path_name(FilePath path) {
+    switch (path) {
+    case FilePath::ReadWrite: return "read-write";
+    case FilePath::MmapCopy: return "mmap-copy";
+    case FilePath::MmapHostPtr: return "mmap-use-host-ptr";
+    }
+    return "unknown";
+}
+
+// Runs vecadd from options.fileDir/a.bin and b.bin into c.bin (raw native-endian int32) along
+// each FilePath, end to end from opening the inputs to the output being in the page cache.
+// Missing inputs are created with the usual constants 1 and 2.
+void run_file_io(const cl::Context& context, const cl::CommandQueue& queue, const cl::Program& program,
+                 const BenchmarkOptions& options, const DeviceIdentity& identity, std::vector<ResultRecord>& records) {
+#ifdef __linux__
+    cl_int err;
+    std::string pathA = options.fileDir + "/a.bin", pathB = options.fileDir + "/b.bin", pathC = options.fileDir + "/c.bin";
+    std::error_code ec;
+    std::filesystem::create_directories(options.fileDir, ec);
+    if (file_size(pathA) < sizeof(int) && !write_constant_file(pathA, options.fileBytes, 1)) return;
+    if (file_size(pathB) < sizeof(int) && !write_constant_file(pathB, options.fileBytes, 2)) return;
+    size_t elements = std::min(std::min(file_size(pathA), file_size(pathB)) / sizeof(int), (size_t)INT_MAX);
+    size_t bytes = sizeof(int) * elements;
+
+    cl::Kernel kernel(program, "vecadd", &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create kernel 'vecadd'." << std::endl; return; }
+    kernel.setArg(3, (int)elements);
+
+    // Staging and device buffers of the copying paths are set up once, like a long-running ingest
+    MappedRegion stagingA, stagingB, stagingC;
+    if (!map_anonymous(bytes, stagingA) || !map_anonymous(bytes, stagingB) || !map_anonymous(bytes, stagingC)) return;
+    cl::Buffer d_A(context, CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY, bytes, nullptr, &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create buffer d_A." << std::endl; return; }
+    cl::Buffer d_B(context, CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY, bytes, nullptr, &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create buffer d_B." << std::endl; return; }
+    cl::Buffer d_C(context, CL_MEM_WRITE_ONLY | CL_MEM_HOST_READ_ONLY, bytes, nullptr, &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create buffer d_C." << std::endl; return; }
+
+    // One end-to-end pass along `path`
+    auto run_pass = [&](FilePath path) {
+        cl::NDRange global(elements);
+        if (path == FilePath::ReadWrite) {
+            const std::pair<const std::string*, const MappedRegion*> inputs[] = {{&pathA, &stagingA}, {&pathB, &stagingB}};
+            for (const auto& input : inputs) {
+                int fd = open(input.first->c_str(), O_RDONLY);
+                if (fd < 0) return false;
+                posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+                bool ok = read_full(fd, input.second->data, bytes);
+                close(fd);
+                if (!ok) { std::cerr << "Failed to read " << *input.first << std::endl; return false; }
+            }
+            if (queue.enqueueWriteBuffer(d_A, CL_FALSE, 0, bytes, stagingA.data) != CL_SUCCESS) return false;
+            if (queue.enqueueWriteBuffer(d_B, CL_FALSE, 0, bytes, stagingB.data) != CL_SUCCESS) return false;
+            kernel.setArg(0, d_A);
+            kernel.setArg(1, d_B);
+            kernel.setArg(2, d_C);
+            if (queue.enqueueNDRangeKernel(kernel, cl::NullRange, global, cl::NullRange) != CL_SUCCESS) return false;
+            if (queue.enqueueReadBuffer(d_C, CL_TRUE, 0, bytes, stagingC.data) != CL_SUCCESS) return false;
+            int fd = open(pathC.c_str(), O_WRONLY | O_CREAT, 0644);
+            if (fd < 0) return false;
+            bool ok = ftruncate(fd, (off_t)bytes) == 0 && write_full(fd, stagingC.data, bytes);
+            close(fd);
+            if (!ok) std::cerr << "Failed to write " << pathC << std::endl;
+            return ok;
+        }
+
+        MappedRegion mapA, mapB, mapC;
+        if (!map_file(pathA, bytes, false, mapA) || !map_file(pathB, bytes, false, mapB) ||
+            !map_file(pathC, bytes, true, mapC)) return false;
+        if (path == FilePath::MmapCopy) {
+            if (queue.enqueueWriteBuffer(d_A, CL_FALSE, 0, bytes, mapA.data) != CL_SUCCESS) return false;
+            if (queue.enqueueWriteBuffer(d_B, CL_FALSE, 0, bytes, mapB.data) != CL_SUCCESS) return false;
+            kernel.setArg(0, d_A);
+            kernel.setArg(1, d_B);
+            kernel.setArg(2, d_C);
+            if (queue.enqueueNDRangeKernel(kernel, cl::NullRange, global, cl::NullRange) != CL_SUCCESS) return false;
+            return queue.enqueueReadBuffer(d_C, CL_TRUE, 0, bytes, mapC.data) == CL_SUCCESS;
+        }
+
+        // mmap returns page-aligned memory, which satisfies CL_DEVICE_MEM_BASE_ADDR_ALIGN for zero-copy
+        cl::Buffer h_A(context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, bytes, mapA.data, &err);
+        if (err != CL_SUCCESS) { print_cl_error(err); return false; }
+        cl::Buffer h_B(context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, bytes, mapB.data, &err);
+        if (err != CL_SUCCESS) { print_cl_error(err); return false; }
+        cl::Buffer h_C(context, CL_MEM_WRITE_ONLY | CL_MEM_USE_HOST_PTR, bytes, mapC.data, &err);
+        if (err != CL_SUCCESS) { print_cl_error(err); return false; }
+        kernel.setArg(0, h_A);
+        kernel.setArg(1, h_B);
+        kernel.setArg(2, h_C);
+        if (queue.enqueueNDRangeKernel(kernel, cl::NullRange, global, cl::NullRange) != CL_SUCCESS) return false;
+        // Mapping C makes the runtime bring the host copy up to date
+        void* mapped = queue.enqueueMapBuffer(h_C, CL_TRUE, CL_MAP_READ, 0, bytes, nullptr, nullptr, &err);
+        if (err != CL_SUCCESS) { print_cl_error(err); return false; }
+        queue.enqueueUnmapMemObject(h_C, mapped);
+        return queue.finish() == CL_SUCCESS;
+    };
+
+    std::string hugePages = "unknown";
+    std::ifstream thp("/sys/kernel/mm/transparent_hugepage/enabled");
+    if (thp) std::getline(thp, hugePages);
+    // The passes map the files afresh each time; probe mappings, released before the passes, show
+    // which hints this filesystem takes
+    std::string inputAdvice, outputAdvice;
+    {
+        MappedRegion probeInput, probeOutput;
+        if (!map_file(pathA, bytes, false, probeInput) || !map_file(pathC, bytes, true, probeOutput)) return;
+        inputAdvice = probeInput.advice;
+        outputAdvice = probeOutput.advice;
+    }
+    std::cout << "\n--- File I/O (" << bytes / (1024.0 * 1024.0) << " MB per file in " << options.fileDir << ", "
+              << (options.fileWarm ? "warm" : "cold") << " page cache, median of " << options.iterations
+              << " iterations) ---" << std::endl;
+    std::cout << "Transparent huge pages: " << hugePages << std::endl;
+    std::cout << "Advice on input mappings: " << inputAdvice << std::endl;
+    std::cout << "Advice on output mapping: " << outputAdvice << std::endl;
+    std::cout << "Advice on staging memory: " << stagingA.advice << std::endl;
+    std::cout << std::left << std::setw(20) << "Path" << std::right
+              << std::setw(14) << "Median (ms)"
+              << std::setw(10) << "p95"
+              << std::setw(12) << "GB/s"
+              << "  Verification" << std::endl;
+
+    double fileBytes = 3.0 * (double)bytes; // Two input files read, one output file written
+    for (FilePath path : ALL_FILE_PATHS) {
+        std::vector<double> samples;
+        int totalIterations = options.warmupIterations + options.iterations;
+        bool ok = true;
+        for (int iter = 0; ok && iter < totalIterations; ++iter) {
+            // The verified pass must write every element of the output file itself
+            if (iter == totalIterations - 1 && !write_constant_file(pathC, bytes, VERIFY_POISON)) return;
+            if (!options.fileWarm) {
+                evict_file(pathA);
+                evict_file(pathB);
+            }
+            auto start = std::chrono::steady_clock::now();
+            ok = run_pass(path);
+            auto end = std::chrono::steady_clock::now();
+            if (iter >= options.warmupIterations) samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        if (!ok) {
+            std::cout << std::left << std::setw(20) << file_path_name(path) << std::right << "  failed" << std::endl;
+            continue;
+        }
+
+        // Check what actually landed in the output file
+        VerifyResult verify;
+        MappedRegion mapA, mapB, mapC;
+        if (file_size(pathC) == bytes && map_file(pathA, bytes, false, mapA) && map_file(pathB, bytes, false, mapB) &&
+            map_file(pathC, bytes, true, mapC)) {
+            verify = verify_vecadd(mapA.ints(), mapB.ints(), mapC.ints(), elements);
+        }
+
+        ResultRecord record;
+        record.identity = identity;
+        record.test = "file_io";
+        record.strategy = file_path_name(path);
+        record.kernel = "vecadd";
+        record.elements = (long long)elements;
+        record.phase = "overall";
+        record.bytes = fileBytes;
+        record.stats = compute_stats(samples);
+        record.verified = verify.correct;
+        records.push_back(record);
+        std::cout << std::left << std::setw(20) << file_path_name(path) << std::right
+                  << std::setw(14) << record.stats.median
+                  << std::setw(10) << record.stats.p95
+                  << std::setw(12) << gb_per_s(fileBytes, record.stats.median)
+                  << "  " << describe_verification(verify) << std::endl;
+    }
+#else
+    (void)context; (void)queue; (void)program; (void)options; (void)identity; (void)records;
+    std::cerr << "--file-io needs mmap and posix_fadvise; it is only available on Linux." << std::endl;
+#endif
+}
+
+// Host layout of the access_aos kernel's AccessItem
+struct AccessItem {
+    cl_int a;
+    cl_int b;
+    cl_int c;
+    cl_int unused;
+};
+
+// Profiled time of `kernel` over `global` work-items across warmup + measured launches
+static bool time_access_kernel(const cl::CommandQueue& queue, const cl::Kernel& kernel, size_t global,
+                               const BenchmarkOptions& options, PhaseStats& stats) {
+    std::vector<double> samples;
+    for (int iter = 0; iter < options.warmupIterations + options.iterations; ++iter) {
+        cl::Event kernelEvent;
+        cl_int err = queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(global), cl::NullRange, nullptr, &kernelEvent);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to enqueue access-pattern kernel." << std::endl; return false; }
+        kernelEvent.wait();
+        if (iter >= options.warmupIterations) samples.push_back(event_ms(kernelEvent));
+    }
+    stats = compute_stats(samples);
+    return true;
+}
+
+// Runs C = A + B with strided, gathered, scattered and array-of-structs addressing over
+// options.accessBytes per array and reports each pattern's bandwidth as a fraction of the
+// coalesced vecadd over the same data
+void run_access_patterns(const cl::Context& context, const cl::CommandQueue& queue, const cl::Program& program,
+                         const BenchmarkOptions& options, const DeviceIdentity& identity, std::vector<ResultRecord>& records) {
+    cl_int err;
+    int elements = (int)std::min<size_t>(options.accessBytes / sizeof(int), INT_MAX / sizeof(AccessItem));
+    size_t bytes = sizeof(int) * elements;
+
+    // A is position-dependent so a pattern that reads or writes the wrong element fails verification
+    HostVector h_A(elements), h_B(elements, 2), h_C(elements);
+    for (int i = 0; i < elements; ++i) h_A[i] = i;
+    HostVector h_index(elements);
+    std::iota(h_index.begin(), h_index.end(), 0);
+    std::shuffle(h_index.begin(), h_index.end(), std::mt19937(12345));
+    // A as the gather and scatter kernels see it at each output position
+    HostVector h_gathered(elements), h_scattered(elements);
+    for (int i = 0; i < elements; ++i) {
+        h_gathered[i] = h_A[h_index[i]];
+        h_scattered[h_index[i]] = h_A[i];
+    }
+
+    cl::Buffer d_A(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, bytes, h_A.data(), &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create buffer d_A." << std::endl; return; }
+    cl::Buffer d_B(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, bytes, h_B.data(), &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create buffer d_B." << std::endl; return; }
+    cl::Buffer d_C(context, CL_MEM_READ_WRITE, bytes, nullptr, &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create buffer d_C." << std::endl; return; }
+    cl::Buffer d_index(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, bytes, h_index.data(), &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create index buffer." << std::endl; return; }
+    std::vector<AccessItem> h_items(elements);
+    for (int i = 0; i < elements; ++i) h_items[i] = {h_A[i], h_B[i], VERIFY_POISON, 0};
+    cl::Buffer d_items(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(AccessItem) * elements, h_items.data(), &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create struct buffer." << std::endl; return; }
+
+    struct AccessPattern {
+        std::string name;
+        std::string kernelName;
+        int stride;          // access_strided only
+        int items;           // Work-items, and elements the operation covers
+        double bytesPerItem; // Bytes the operation asks for per work-item, index reads included
+    };
+    std::vector<AccessPattern> patterns = {{"coalesced", "vecadd", 1, elements, 12.0}};
+    for (int stride : options.accessStrides) {
+        if (elements / stride == 0) continue;
+        // Round down to a multiple of the stride so the column walk covers every element once
+        patterns.push_back({"stride " + std::to_string(stride), "access_strided", stride, elements / stride * stride, 12.0});
+    }
+    patterns.push_back({"gather", "access_gather", 1, elements, 16.0});
+    patterns.push_back({"scatter", "access_scatter", 1, elements, 16.0});
+    patterns.push_back({"aos", "access_aos", 1, elements, 12.0});
+    patterns.push_back({"soa", "vecadd", 1, elements, 12.0});
+
+    std::cout << "\n--- Access Patterns (" << bytes / (1024.0 * 1024.0) << " MB per array, median of "
+              << options.iterations << " iterations) ---" << std::endl;
+    std::cout << std::left << std::setw(14) << "Pattern" << std::right
+              << std::setw(14) << "Kernel (ms)"
+              << std::setw(12) << "GB/s"
+              << std::setw(14) << "vs coalesced"
+              << "  Verification" << std::endl;
+
+    double baselineGbps = 0.0;
+    for (const auto& pattern : patterns) {
+        cl::Kernel kernel(program, pattern.kernelName.c_str(), &err);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create kernel '" << pattern.kernelName << "'." << std::endl; return; }
+        bool aos = pattern.kernelName == "access_aos";
+        if (aos) {
+            kernel.setArg(0, d_items);
+            kernel.setArg(1, pattern.items);
+        } else {
+            kernel.setArg(0, d_A);
+            kernel.setArg(1, d_B);
+            kernel.setArg(2, d_C);
+            if (pattern.kernelName == "access_gather" || pattern.kernelName == "access_scatter") {
+                kernel.setArg(3, d_index);
+                kernel.setArg(4, pattern.items);
+            } else {
+                kernel.setArg(3, pattern.items);
+                if (pattern.kernelName == "access_strided") kernel.setArg(4, pattern.stride);
+            }
+            // Poison C so elements a pattern fails to write show up
+            queue.enqueueFillBuffer(d_C, VERIFY_POISON, 0, bytes);
+            queue.finish();
+        }
+
+        PhaseStats stats;
+        if (!time_access_kernel(queue, kernel, (size_t)pattern.items, options, stats)) return;
+
+        // Every pattern leaves C = A + B, with A permuted for gather and scatter
+        const int* expectA = h_A.data();
+        if (pattern.kernelName == "access_gather") expectA = h_gathered.data();
+        if (pattern.kernelName == "access_scatter") expectA = h_scattered.data();
+        if (aos) {
+            err = queue.enqueueReadBuffer(d_items, CL_TRUE, 0, sizeof(AccessItem) * elements, h_items.data());
+            for (int i = 0; i < pattern.items; ++i) h_C[i] = h_items[i].c;
+        } else {
+            err = queue.enqueueReadBuffer(d_C, CL_TRUE, 0, bytes, h_C.data());
+        }
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to read access-pattern result." << std::endl; return; }
+        VerifyResult verify = verify_vecadd(expectA, h_B.data(), h_C.data(), pattern.items);
+
+        double gbps = gb_per_s(pattern.bytesPerItem * pattern.items, stats.median);
+        if (pattern.name == "coalesced") baselineGbps = gbps;
+
+        ResultRecord record;
+        record.identity = identity;
+        record.test = "access";
+        record.kernel = pattern.name;
+        record.elements = pattern.items;
+        record.phase = "kernel";
+        record.bytes = pattern.bytesPerItem * pattern.items;
+        record.stats = stats;
+        record.verified = verify.correct;
+        records.push_back(record);
+
+        std::cout << std::left << std::setw(14) << pattern.name << std::right
+                  << std::setw(14) << stats.median
+                  << std::setw(12) << gbps
+                  << std::setw(13) << (baselineGbps > 0.0 ? gbps / baselineGbps * 100.0 : 0.0) << "%"
+                  << "  " << (verify.correct ? "PASSED" : describe_verification(verify)) << std::endl;
+    }
+}
+
+// Reduction and exclusive-scan kernels over uint data, so sums wrap the same way on host and device.
+// The work-group and sub-group forms only exist when the OpenCL C version the program is built for
+// provides the built-ins; the host skips strategies whose kernels are missing from the program.
+static const std::string reduction_kernel_source = R"(
+#if defined(cl_khr_subgroups) && !defined(__opencl_c_subgroups)
+#pragma OPENCL EXTENSION cl_khr_subgroups : enable
+#endif
+#if defined(__opencl_c_work_group_collective_functions) || (__OPENCL_C_VERSION__ >= 200 && __OPENCL_C_VERSION__ < 300)
+#define HAVE_WORK_GROUP_FUNCTIONS
+#endif
+#if defined(__opencl_c_subgroups) || defined(cl_khr_subgroups)
+#define HAVE_SUB_GROUP_FUNCTIONS
+#endif
+
+    #define COMBINE_add(x, y) ((x) + (y))
+    #define COMBINE_min(x, y) min(x, y)
+    #define COMBINE_max(x, y) max(x, y)
+
+    // One global atomic per element: every work-item contends for the same word
+    #define REDUCE_ATOMIC(OP)                                                            \
+    __kernel void reduce_##OP##_atomic(__global const uint *in, __global uint *out,      \
+                                       __local uint *scratch, const uint identity, const int N) \
+    {                                                                                    \
+        int i = get_global_id(0);                                                        \
+        if (i < N) {                                                                     \
+            atomic_##OP(out, in[i]);                                                     \
+        }                                                                                \
+    }
+
+    // Tree over __local memory, then one global atomic per work-group; the local size must be a power of two
+    #define REDUCE_LOCAL(OP)                                                             \
+    __kernel void reduce_##OP##_local(__global const uint *in, __global uint *out,       \
+                                      __local uint *scratch, const uint identity, const int N) \
+    {                                                                                    \
+        int i = get_global_id(0);                                                        \
+        int lid = get_local_id(0);                                                       \
+        scratch[lid] = i < N ? in[i] : identity;                                         \
+        barrier(CLK_LOCAL_MEM_FENCE);                                                    \
+        for (int half = get_local_size(0) / 2; half > 0; half >>= 1) {                   \
+            if (lid < half) {                                                            \
+                scratch[lid] = COMBINE_##OP(scratch[lid], scratch[lid + half]);          \
+            }                                                                            \
+            barrier(CLK_LOCAL_MEM_FENCE);                                                \
+        }                                                                                \
+        if (lid == 0) {                                                                  \
+            atomic_##OP(out, scratch[0]);                                                \
+        }                                                                                \
+    }
+
+    #define REDUCE_WORK_GROUP(OP)                                                        \
+    __kernel void reduce_##OP##_work_group(__global const uint *in, __global uint *out,  \
+                                           __local uint *scratch, const uint identity, const int N) \
+    {                                                                                    \
+        int i = get_global_id(0);                                                        \
+        uint total = work_group_reduce_##OP(i < N ? in[i] : identity);                   \
+        if (get_local_id(0) == 0) {                                                      \
+            atomic_##OP(out, total);                                                     \
+        }                                                                                \
+    }
+
+    // One global atomic per sub-group
+    #define REDUCE_SUB_GROUP(OP)                                                         \
+    __kernel void reduce_##OP##_sub_group(__global const uint *in, __global uint *out,   \
+                                          __local uint *scratch, const uint identity, const int N) \
+    {                                                                                    \
+        int i = get_global_id(0);                                                        \
+        uint total = sub_group_reduce_##OP(i < N ? in[i] : identity);                    \
+        if (get_sub_group_local_id() == 0) {                                             \
+            atomic_##OP(out, total);                                                     \
+        }                                                                                \
+    }
+
+    REDUCE_ATOMIC(add)
+    REDUCE_ATOMIC(min)
+    REDUCE_ATOMIC(max)
+    REDUCE_LOCAL(add)
+    REDUCE_LOCAL(min)
+    REDUCE_LOCAL(max)
+#ifdef HAVE_WORK_GROUP_FUNCTIONS
+    REDUCE_WORK_GROUP(add)
+    REDUCE_WORK_GROUP(min)
+    REDUCE_WORK_GROUP(max)
+#endif
+#ifdef HAVE_SUB_GROUP_FUNCTIONS
+    REDUCE_SUB_GROUP(add)
+    REDUCE_SUB_GROUP(min)
+    REDUCE_SUB_GROUP(max)
+#endif
+
+    // Exclusive scan of one block per work-group; the block totals go to blockSums and are scanned
+    // by the next level, whose outputs scan_add_offsets then adds back. Hillis-Steele over __local memory.
+    __kernel void scan_local(__global const uint *in, __global uint *out, __global uint *blockSums,
+                             __local uint *scratch, const int N)
+    {
+        int i = get_global_id(0);
+        int lid = get_local_id(0);
+        int size = get_local_size(0);
+        uint x = i < N ? in[i] : 0;
+        scratch[lid] = x;
+        barrier(CLK_LOCAL_MEM_FENCE);
+        for (int offset = 1; offset < size; offset <<= 1) {
+            uint left = lid >= offset ? scratch[lid - offset] : 0;
+            barrier(CLK_LOCAL_MEM_FENCE);
+            scratch[lid] += left;
+            barrier(CLK_LOCAL_MEM_FENCE);
+        }
+        if (i < N) {
+            out[i] = scratch[lid] - x;
+        }
+        if (lid == size - 1) {
+            blockSums[get_group_id(0)] = scratch[lid];
+        }
+    }
+
+#ifdef HAVE_WORK_GROUP_FUNCTIONS
+    __kernel void scan_work_group(__global const uint *in, __global uint *out, __global uint *blockSums,
+                                  __local uint *scratch, const int N)
+    {
+        int i = get_global_id(0);
+        uint x = i < N ? in[i] : 0;
+        uint prefix = work_group_scan_exclusive_add(x);
+        if (i < N) {
+            out[i] = prefix;
+        }
+        if (get_local_id(0) == get_local_size(0) - 1) {
+            blockSums[get_group_id(0)] = prefix + x;
+        }
+    }
+#endif
+
+#ifdef HAVE_SUB_GROUP_FUNCTIONS
+    // Scans within each sub-group, then offsets every sub-group by the totals of the ones before it
+    __kernel void scan_sub_group(__global const uint *in, __global uint *out, __global uint *blockSums,
+                                 __local uint *scratch, const int N)
+    {
+        int i = get_global_id(0);
+        uint x = i < N ? in[i] : 0;
+        uint prefix = sub_group_scan_exclusive_add(x);
+        uint group = get_sub_group_id();
+        if (get_sub_group_local_id() == get_sub_group_size() - 1) {
+            scratch[group] = prefix + x;
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+        if (get_local_id(0) == 0) {
+            uint running = 0;
+            for (uint g = 0; g < get_num_sub_groups(); ++g) {
+                uint total = scratch[g];
+                scratch[g] = running;
+                running += total;
+            }
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+        prefix += scratch[group];
+        if (i < N) {
+            out[i] = prefix;
+        }
+        if (get_local_id(0) == get_local_size(0) - 1) {
+            blockSums[get_group_id(0)] = prefix + x;
+        }
+    }
+#endif
+
+    __kernel void scan_add_offsets(__global uint *out, __global const uint *blockOffsets, const int N)
+    {
+        int i = get_global_id(0);
+        if (i < N) {
+            out[i] += blockOffsets[get_group_id(0)];
+        }
+    }
+)";
+
+// How a reduction or scan combines values across work-items
+enum class ReduceStrategy {
+    Atomic,    // A global atomic per element (reductions only)
+    LocalTree, // Tree over __local memory with barriers
+    WorkGroup, // work_group_reduce_* / work_group_scan_exclusive_add built-ins
+    SubGroup,  // sub_group_reduce_* / sub_group_scan_exclusive_add built-ins
+};
+
+static const ReduceStrategy ALL_REDUCE_STRATEGIES[] = {
+    ReduceStrategy::Atomic, ReduceStrategy::LocalTree, ReduceStrategy::WorkGroup, ReduceStrategy::SubGroup,
+};
+
+static const char* reduce_strategy_name(ReduceStrategy strategy) {
+    switch (strategy) {
+        case ReduceStrategy::Atomic: return "atomic";
+        case ReduceStrategy::LocalTree: return "local-tree";
+        case ReduceStrategy::WorkGroup: return "work-group";
+        case ReduceStrategy::SubGroup: return "sub-group";
+    }
+    return "unknown";
+}
+
+// Suffix of the strategy's __kernel functions
+static const char* reduce_strategy_suffix(ReduceStrategy strategy) {
+    switch (strategy) {
+        case ReduceStrategy::Atomic: return "atomic";
+        case ReduceStrategy::LocalTree: return "local";
+        case ReduceStrategy::WorkGroup: return "work_group";
+        case ReduceStrategy::SubGroup: return "sub_group";
+    }
+    return "unknown";
+}
+
+// -cl-std for the newest OpenCL C the device compiles, so the 2.x/3.0 built-ins are visible;
+// empty for 1.x devices, which compile OpenCL C 1.x by default
+static std::string newest_cl_std(const cl::Device& device) {
+    std::string version;
+    device.getInfo(CL_DEVICE_VERSION, &version);
+    if (version.compare(0, 9, "OpenCL 3.") == 0) return "-cl-std=CL3.0";
+    std::string cVersion;
+    device.getInfo(CL_DEVICE_OPENCL_C_VERSION, &cVersion);
+    if (cVersion.compare(0, 11, "OpenCL C 2.") == 0) return "-cl-std=CL2.0";
+    return "";
+}
+
+// Largest power-of-two local size up to 256 that the device accepts for `kernel`
+static size_t reduce_local_size(const cl::Device& device, const cl::Kernel& kernel) {
+    size_t limit = 1;
+    kernel.getWorkGroupInfo(device, CL_KERNEL_WORK_GROUP_SIZE, &limit);
+    size_t local = 256;
+    while (local > 1 && local > limit) local /= 2;
+    return local;
+}
+
+// Runs sum/min/max reductions and an exclusive prefix sum over options.reduceElements uints with
+// each strategy the device supports, verifying every result against the host
+void run_reductions(DeviceSession& session, const BenchmarkOptions& options, const DeviceIdentity& identity,
+                    std::vector<ResultRecord>& records) {
+    cl_int err;
+    const cl::Device& device = session.device;
+    const cl::Context& context = session.context;
+    const cl::CommandQueue& queue = session.queue;
+    int elements = options.reduceElements;
+    size_t bytes = sizeof(cl_uint) * elements;
+
+    std::string buildOptions = newest_cl_std(device);
+    cl::Program program;
+    BuildStats buildStats;
+    if (!session_program(session, reduction_kernel_source, buildOptions, options, program, buildStats)) return;
+
+    std::vector<cl_uint> h_in(elements), h_out(elements);
+    std::mt19937 generator(12345);
+    for (auto& value : h_in) value = generator();
+    cl::Buffer d_in(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, bytes, h_in.data(), &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create reduction input buffer." << std::endl; return; }
+    cl::Buffer d_out(context, CL_MEM_READ_WRITE, bytes, nullptr, &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create reduction output buffer." << std::endl; return; }
+
+    std::cout << "\n--- Reductions and Scan (" << elements << " uint elements, "
+              << (buildOptions.empty() ? "default OpenCL C" : buildOptions) << ", median of "
+              << options.iterations << " iterations) ---" << std::endl;
+    std::cout << std::left << std::setw(16) << "Operation" << std::setw(12) << "Strategy" << std::right
+              << std::setw(7) << "Local"
+              << std::setw(14) << "Kernel (ms)"
+              << std::setw(12) << "GB/s"
+              << std::setw(12) << "Gelem/s"
+              << "  Verification" << std::endl;
+
+    auto report = [&](const std::string& operation, ReduceStrategy strategy, size_t local, double bytesMoved,
+                      const PhaseStats& stats, const VerifyResult& verify) {
+        std::cout << std::left << std::setw(16) << operation << std::setw(12) << reduce_strategy_name(strategy) << std::right
+                  << std::setw(7) << local
+                  << std::setw(14) << stats.median
+                  << std::setw(12) << gb_per_s(bytesMoved, stats.median)
+                  << std::setw(12) << gb_per_s(elements, stats.median)
+                  << "  " << (verify.correct ? "PASSED" : describe_verification(verify)) << std::endl;
+
+        ResultRecord record;
+        record.identity = identity;
+        record.test = "reduction";
+        record.strategy = reduce_strategy_name(strategy);
+        record.kernel = operation;
+        record.localSize = local;
+        record.elements = elements;
+        record.phase = "kernel";
+        record.bytes = bytesMoved;
+        record.stats = stats;
+        record.verified = verify.correct;
+        records.push_back(record);
+    };
+    auto skip = [&](const std::string& operation, ReduceStrategy strategy) {
+        std::cout << std::left << std::setw(16) << operation << std::setw(12) << reduce_strategy_name(strategy)
+                  << "skipped: not available in this device's OpenCL C" << std::endl;
+    };
+
+    struct ReduceOp {
+        const char* name;
+        cl_uint identity;
+        cl_uint (*combine)(cl_uint, cl_uint);
+    };
+    const ReduceOp ops[] = {
+        {"add", 0u, [](cl_uint x, cl_uint y) { return x + y; }},
+        {"min", UINT_MAX, [](cl_uint x, cl_uint y) { return std::min(x, y); }},
+        {"max", 0u, [](cl_uint x, cl_uint y) { return std::max(x, y); }},
+    };
+    for (const auto& op : ops) {
+        cl_uint expected = op.identity;
+        for (cl_uint value : h_in) expected = op.combine(expected, value);
+        std::string operation = std::string("reduce ") + op.name;
+
+        for (ReduceStrategy strategy : ALL_REDUCE_STRATEGIES) {
+            std::string kernelName = std::string("reduce_") + op.name + "_" + reduce_strategy_suffix(strategy);
+            cl::Kernel kernel(program, kernelName.c_str(), &err);
+            if (err != CL_SUCCESS) { skip(operation, strategy); continue; }
+            size_t local = reduce_local_size(device, kernel);
+            size_t global = (elements + local - 1) / local * local;
+            kernel.setArg(0, d_in);
+            kernel.setArg(1, d_out);
+            kernel.setArg(2, cl::Local(local * sizeof(cl_uint)));
+            kernel.setArg(3, op.identity);
+            kernel.setArg(4, elements);
+
+            std::vector<double> samples;
+            cl_uint result = 0;
+            for (int iter = 0; iter < options.warmupIterations + options.iterations; ++iter) {
+                cl::Event kernelEvent;
+                err = queue.enqueueFillBuffer(d_out, op.identity, 0, sizeof(cl_uint));
+                if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to reset the reduction result." << std::endl; return; }
+                err = queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(global), cl::NDRange(local), nullptr, &kernelEvent);
+                if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to enqueue kernel '" << kernelName << "'." << std::endl; return; }
+                err = queue.enqueueReadBuffer(d_out, CL_TRUE, 0, sizeof(cl_uint), &result);
+                if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to read the reduction result." << std::endl; return; }
+                if (iter >= options.warmupIterations) samples.push_back(event_ms(kernelEvent));
+            }
+
+            VerifyResult verify;
+            verify.checked = 1;
+            verify.correct = result == expected;
+            verify.expected = (int)expected;
+            verify.actual = (int)result;
+            report(operation, strategy, local, (double)bytes, compute_stats(samples), verify);
+        }
+    }
+
+    // Exclusive scan: level k scans its input in blocks of `local` and writes the block totals as
+    // the input of level k + 1, until a level fits in one block; offsets are then added back down
+    std::vector<cl_uint> expectedScan(elements);
+    cl_uint running = 0;
+    for (int i = 0; i < elements; ++i) {
+        expectedScan[i] = running;
+        running += h_in[i];
+    }
+    for (ReduceStrategy strategy : ALL_REDUCE_STRATEGIES) {
+        if (strategy == ReduceStrategy::Atomic) continue;
+        std::string kernelName = std::string("scan_") + reduce_strategy_suffix(strategy);
+        cl::Kernel probe(program, kernelName.c_str(), &err);
+        if (err != CL_SUCCESS) { skip("exclusive scan", strategy); continue; }
+        size_t local = reduce_local_size(device, probe);
+        cl::Kernel addProbe(program, "scan_add_offsets", &err);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create kernel 'scan_add_offsets'." << std::endl; return; }
+        local = std::min(local, reduce_local_size(device, addProbe));
+
+        struct ScanLevel {
+            cl::Buffer in, out;
+            int count = 0;
+            size_t groups = 0;
+            cl::Kernel scan, add;
+        };
+        std::vector<ScanLevel> levels(1);
+        levels[0].in = d_in;
+        levels[0].out = d_out;
+        levels[0].count = elements;
+        while (true) {
+            ScanLevel& level = levels.back();
+            level.groups = (level.count + local - 1) / local;
+            if (level.groups == 1) break;
+            ScanLevel next;
+            next.count = (int)level.groups;
+            next.in = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint) * next.count, nullptr, &err);
+            if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create scan block buffer." << std::endl; return; }
+            next.out = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint) * next.count, nullptr, &err);
+            if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create scan block buffer." << std::endl; return; }
+            levels.push_back(next);
+        }
+        cl::Buffer d_total(context, CL_MEM_READ_WRITE, sizeof(cl_uint), nullptr, &err);
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create scan total buffer." << std::endl; return; }
+        for (size_t k = 0; k < levels.size(); ++k) {
+            ScanLevel& level = levels[k];
+            level.scan = cl::Kernel(program, kernelName.c_str(), &err);
+            if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create kernel '" << kernelName << "'." << std::endl; return; }
+            level.scan.setArg(0, level.in);
+            level.scan.setArg(1, level.out);
+            level.scan.setArg(2, k + 1 < levels.size() ? levels[k + 1].in : d_total);
+            level.scan.setArg(3, cl::Local(local * sizeof(cl_uint)));
+            level.scan.setArg(4, level.count);
+            if (k + 1 < levels.size()) {
+                level.add = cl::Kernel(program, "scan_add_offsets", &err);
+                if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create kernel 'scan_add_offsets'." << std::endl; return; }
+                level.add.setArg(0, level.out);
+                level.add.setArg(1, levels[k + 1].out);
+                level.add.setArg(2, level.count);
+            }
+        }
+
+        std::vector<double> samples;
+        for (int iter = 0; iter < options.warmupIterations + options.iterations; ++iter) {
+            std::vector<cl::Event> events;
+            for (const auto& level : levels) {
+                events.emplace_back();
+                err = queue.enqueueNDRangeKernel(level.scan, cl::NullRange, cl::NDRange(level.groups * local), cl::NDRange(local), nullptr, &events.back());
+                if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to enqueue kernel '" << kernelName << "'." << std::endl; return; }
+            }
+            for (size_t k = levels.size() - 1; k-- > 0;) {
+                events.emplace_back();
+                err = queue.enqueueNDRangeKernel(levels[k].add, cl::NullRange, cl::NDRange(levels[k].groups * local), cl::NDRange(local), nullptr, &events.back());
+                if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to enqueue kernel 'scan_add_offsets'." << std::endl; return; }
+            }
+            queue.finish();
+            if (iter >= options.warmupIterations) samples.push_back(phase_ms(events));
+        }
+
+        err = queue.enqueueReadBuffer(d_out, CL_TRUE, 0, bytes, h_out.data());
+        if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to read the scan result." << std::endl; return; }
+        VerifyResult verify;
+        verify.checked = elements;
+        verify.correct = true;
+        for (int i = 0; i < elements; ++i) {
+            if (h_out[i] != expectedScan[i]) {
+                verify.correct = false;
+                verify.firstMismatch = i;
+                verify.expected = (int)expectedScan[i];
+                verify.actual = (int)h_out[i];
+                break;
+            }
+        }
+        // The scan reads and writes every element once; the block levels add under 1% for local >= 128
+        report("exclusive scan", strategy, local, 2.0 * bytes, compute_stats(samples), verify);
+    }
+}
+
+// vecadd whose shape is fixed by -D build options rather than arguments: T (element type), VEC
+// (vector width), UNROLL (vectors per work-item) and, for the specialized binaries, N (element
+// count), LOCAL_SIZE (required work-group size) and EVEN (the launch covers N exactly, so no
+// bounds check). Built without N the same kernel is the generic binary taking the count at run time.
+static const std::string specialized_kernel_source = R"(
+#ifdef ENABLE_FP16
+#pragma OPENCL EXTENSION cl_khr_fp16 : enable
+#endif
+#ifdef ENABLE_FP64
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+#endif
+
+    #define CAT_(a, b) a##b
+    #define CAT(a, b) CAT_(a, b)
+#if VEC == 1
+    #define LOAD(p, v) (p)[v]
+    #define STORE(x, p, v) ((p)[v] = (x))
+#else
+    #define LOAD(p, v) CAT(vload, VEC)(v, p)
+    #define STORE(x, p, v) CAT(vstore, VEC)(x, v, p)
+#endif
+
+    // Each work-item handles UNROLL vectors spaced a work-group apart, so every unrolled access stays coalesced
+#ifdef LOCAL_SIZE
+    __attribute__((reqd_work_group_size(LOCAL_SIZE, 1, 1)))
+#endif
+    __kernel void vecadd_specialized(__global const T *A, __global const T *B, __global T *C, const int n)
+    {
+#ifdef LOCAL_SIZE
+        const int local = LOCAL_SIZE;
+#else
+        const int local = get_local_size(0);
+#endif
+#ifndef EVEN
+#ifdef N
+        const int vectors = N / VEC;
+#else
+        const int vectors = n / VEC;
+#endif
+#endif
+        int first = get_group_id(0) * local * UNROLL + get_local_id(0);
+        #pragma unroll
+        for (int u = 0; u < UNROLL; ++u) {
+            int v = first + u * local;
+#ifndef EVEN
+            if (v >= vectors) return;
+#endif
+            STORE(LOAD(A, v) + LOAD(B, v), C, v);
+        }
+    }
 )";
 
-// Function to print OpenCL errors
-void print_cl_error(cl_int err) {
-    std::cerr << "OpenCL Error: " << err << std::endl;
+// -D options selecting the element type and shape of vecadd_specialized
+static std::string specialization_options(DataType type, int width, int unroll) {
+    std::ostringstream buildOptions;
+    buildOptions << "-DT=" << data_type_name(type) << " -DVEC=" << width << " -DUNROLL=" << unroll;
+    if (type == DataType::Half) buildOptions << " -DENABLE_FP16";
+    if (type == DataType::Double) buildOptions << " -DENABLE_FP64";
+    return buildOptions.str();
+}
+
+// Runs vecadd_specialized for a given type with A = 1 and B = 2 through the type matrix's host path
+static bool run_specialized_kernel(const cl::Context& context, const cl::CommandQueue& queue, const cl::Program& program,
+                                   BufferPool* pool, DataType type, int elements, size_t global, size_t local,
+                                   const BenchmarkOptions& options, TypedResult& result) {
+    const char* kernelName = "vecadd_specialized";
+    switch (type) {
+    case DataType::Int: return run_typed_kernel<cl_int>(context, queue, program, pool, kernelName, elements, 3, options, result, global, local);
+    case DataType::Long: return run_typed_kernel<cl_long>(context, queue, program, pool, kernelName, elements, 3, options, result, global, local);
+    case DataType::Float: return run_typed_kernel<cl_float>(context, queue, program, pool, kernelName, elements, 3, options, result, global, local);
+    case DataType::Half: return run_typed_kernel<HalfBits>(context, queue, program, pool, kernelName, elements, 3, options, result, global, local);
+    case DataType::Double: return run_typed_kernel<cl_double>(context, queue, program, pool, kernelName, elements, 3, options, result, global, local);
+    }
+    return false;
+}
+
+// Benchmarks vecadd built per type x vector width x unroll twice: a generic binary with a runtime
+// count and bounds check, and one specialized with -DN, -DLOCAL_SIZE and, when the launch divides
+// the count evenly, -DEVEN. With --binary-cache each specialized binary is cached per device.
+void run_specialization(DeviceSession& session, const BenchmarkOptions& options, const DeviceIdentity& identity,
+                        std::vector<ResultRecord>& records) {
+    cl_int err;
+    const cl::Device& device = session.device;
+    const cl::Context& context = session.context;
+    const cl::CommandQueue& queue = session.queue;
+    int elements = options.specElements;
+
+    std::cout << "\n--- Kernel Specialization (" << elements << " elements, median of "
+              << options.iterations << " iterations) ---" << std::endl;
+    std::cout << std::left << std::setw(8) << "Type" << std::right
+              << std::setw(5) << "Vec"
+              << std::setw(8) << "Unroll"
+              << std::setw(7) << "Local"
+              << std::setw(14) << "Generic (ms)"
+              << std::setw(14) << "Special (ms)"
+              << std::setw(10) << "Speedup"
+              << std::setw(13) << "Build (ms)"
+              << "  Bounds  Verification" << std::endl;
+
+    for (DataType type : options.specTypes) {
+        if (!data_type_supported(device, type)) {
+            std::cout << std::left << std::setw(8) << data_type_name(type) << "skipped: device lacks "
+                      << data_type_extension(type) << std::endl;
+            continue;
+        }
+        for (int width : options.specWidths) {
+            for (int unroll : options.specUnrolls) {
+                std::string label = std::string(data_type_name(type)) + " vec" + std::to_string(width) + " unroll" + std::to_string(unroll);
+                if (elements % width != 0) {
+                    std::cout << std::left << std::setw(8) << data_type_name(type) << std::right << std::setw(5) << width
+                              << std::setw(8) << unroll << "  skipped: " << elements << " elements are not a multiple of the width" << std::endl;
+                    continue;
+                }
+                std::string genericOptions = specialization_options(type, width, unroll);
+                cl::Program generic;
+                BuildStats genericBuild;
+                if (!session_program(session, specialized_kernel_source, genericOptions, options, generic, genericBuild)) continue;
+                cl::Kernel probe(generic, "vecadd_specialized", &err);
+                if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create kernel 'vecadd_specialized'." << std::endl; continue; }
+                size_t local = reduce_local_size(device, probe);
+
+                // Both binaries get the same launch, so only what the compiler knows differs
+                size_t vectors = elements / width;
+                size_t perGroup = local * unroll;
+                size_t global = (vectors + perGroup - 1) / perGroup * local;
+                bool even = vectors % perGroup == 0;
+                std::string specialOptions = genericOptions + " -DN=" + std::to_string(elements) +
+                                             " -DLOCAL_SIZE=" + std::to_string(local) + (even ? " -DEVEN" : "");
+                cl::Program special;
+                BuildStats specialBuild;
+                if (!session_program(session, specialized_kernel_source, specialOptions, options, special, specialBuild)) continue;
+
+                TypedResult genericResult, specialResult;
+                genericResult.type = specialResult.type = type;
+                if (!run_specialized_kernel(context, queue, generic, &session.pool, type, elements, global, local, options, genericResult)) continue;
+                if (!run_specialized_kernel(context, queue, special, &session.pool, type, elements, global, local, options, specialResult)) continue;
+
+                double bytes = 3.0 * (double)genericResult.elementSize * elements;
+                double buildMs = specialBuild.fromCache ? specialBuild.binaryMs : specialBuild.sourceMs;
+                bool verified = genericResult.verify.correct && specialResult.verify.correct;
+                std::cout << std::left << std::setw(8) << data_type_name(type) << std::right
+                          << std::setw(5) << width
+                          << std::setw(8) << unroll
+                          << std::setw(7) << local
+                          << std::setw(14) << genericResult.kernel.median
+                          << std::setw(14) << specialResult.kernel.median
+                          << std::setw(9) << (specialResult.kernel.median > 0.0 ? genericResult.kernel.median / specialResult.kernel.median : 0.0) << "x"
+                          << std::setw(13) << buildMs << (specialBuild.fromCache ? "*" : " ")
+                          << " " << std::left << std::setw(7) << (even ? "none" : "kept") << " "
+                          << (verified ? "PASSED" : describe_verification(genericResult.verify.correct ? specialResult.verify : genericResult.verify))
+                          << std::right << std::endl;
+
+                const std::pair<const char*, const TypedResult*> binaries[] = {{"generic", &genericResult}, {"specialized", &specialResult}};
+                for (const auto& binary : binaries) {
+                    ResultRecord record;
+                    record.identity = identity;
+                    record.test = "specialize";
+                    record.strategy = binary.first;
+                    record.kernel = label;
+                    record.localSize = local;
+                    record.elements = elements;
+                    record.phase = "kernel";
+                    record.bytes = bytes;
+                    record.stats = binary.second->kernel;
+                    record.verified = binary.second->verify.correct;
+                    records.push_back(record);
+                }
+            }
+        }
+    }
+    std::cout << "Build: compile of the specialized binary from source; * = loaded from the binary cache" << std::endl;
+}
+
+// One counter integrated by the energy meter: a cumulative energy counter or an instantaneous power
+struct EnergyCounter {
+    std::string label;
+    std::string path;           // sysfs file, in uJ (cumulative) or uW (power); empty for NVML
+    bool cumulative = true;
+    double wrapUj = 0.0;        // Value at which a cumulative counter wraps back to 0; 0 = unknown
+    void* nvmlDevice = nullptr; // NVML handle read instead of a sysfs file
+    double last = -1.0;         // Previous reading: uJ for cumulative counters, W for power
+};
+
+#ifdef __linux__
+// The NVML entry points used, resolved from libnvidia-ml at run time so the benchmark neither
+// builds against nor requires the NVIDIA driver's management library
+struct NvmlApi {
+    bool loaded = false;
+    int (*deviceGetHandleByPciBusId)(const char*, void**) = nullptr;
+    int (*deviceGetTotalEnergyConsumption)(void*, unsigned long long*) = nullptr; // mJ, Volta and later
+    int (*deviceGetPowerUsage)(void*, unsigned int*) = nullptr;                   // mW
+};
+
+static const NvmlApi& nvml_api() {
+    static const NvmlApi api = [] {
+        NvmlApi nvml;
+        void* library = dlopen("libnvidia-ml.so.1", RTLD_NOW | RTLD_LOCAL);
+        if (!library) return nvml;
+        auto init = reinterpret_cast<int (*)()>(dlsym(library, "nvmlInit_v2"));
+        nvml.deviceGetHandleByPciBusId = reinterpret_cast<int (*)(const char*, void**)>(dlsym(library, "nvmlDeviceGetHandleByPciBusId_v2"));
+        nvml.deviceGetTotalEnergyConsumption = reinterpret_cast<int (*)(void*, unsigned long long*)>(dlsym(library, "nvmlDeviceGetTotalEnergyConsumption"));
+        nvml.deviceGetPowerUsage = reinterpret_cast<int (*)(void*, unsigned int*)>(dlsym(library, "nvmlDeviceGetPowerUsage"));
+        // NVML_SUCCESS is 0
+        nvml.loaded = init && init() == 0 && nvml.deviceGetHandleByPciBusId;
+        return nvml;
+    }();
+    return api;
+}
+#endif
+
+// Reads a counter: uJ for cumulative counters, W for power counters; negative if unreadable
+static double read_energy_counter(const EnergyCounter& counter) {
+#ifdef __linux__
+    if (counter.nvmlDevice) {
+        const NvmlApi& nvml = nvml_api();
+        if (counter.cumulative) {
+            unsigned long long millijoules = 0;
+            if (nvml.deviceGetTotalEnergyConsumption(counter.nvmlDevice, &millijoules) != 0) return -1.0;
+            return millijoules * 1000.0;
+        }
+        unsigned int milliwatts = 0;
+        if (nvml.deviceGetPowerUsage(counter.nvmlDevice, &milliwatts) != 0) return -1.0;
+        return milliwatts / 1000.0;
+    }
+#endif
+    std::string text = read_sysfs(counter.path);
+    if (text.empty()) return -1.0;
+    double value = std::strtod(text.c_str(), nullptr);
+    return counter.cumulative ? value : value / 1e6;
+}
+
+// Finds the energy counters covering `device`: RAPL packages for CPU devices, NVML for NVIDIA GPUs
+// and the PCI device's hwmon for the others (amdgpu, and Xe/i915 discrete GPUs). Counters that
+// exist but cannot be read (RAPL energy_uj is root-only on most distributions) are reported in `note`.
+static std::vector<EnergyCounter> find_energy_counters(const cl::Device& device, std::string& note) {
+    std::vector<EnergyCounter> counters;
+#ifdef __linux__
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    cl_device_type type = 0;
+    device.getInfo(CL_DEVICE_TYPE, &type);
+    if (type & CL_DEVICE_TYPE_CPU) {
+        // Top-level intel-rapl:N zones are the packages; intel-rapl:N:M are their sub-domains
+        for (const auto& entry : fs::directory_iterator("/sys/class/powercap", ec)) {
+            std::string zone = entry.path().filename().string();
+            if (zone.compare(0, 11, "intel-rapl:") != 0 || std::count(zone.begin(), zone.end(), ':') != 1) continue;
+            EnergyCounter counter;
+            counter.label = "rapl " + read_sysfs(entry.path().string() + "/name");
+            counter.path = entry.path().string() + "/energy_uj";
+            counter.wrapUj = std::strtod(read_sysfs(entry.path().string() + "/max_energy_range_uj").c_str(), nullptr);
+            counters.push_back(counter);
+        }
+        if (counters.empty()) note = "no RAPL powercap zones";
+    } else {
+        std::string address = device_pci_address(device);
+        cl_uint vendorId = 0;
+        device.getInfo(CL_DEVICE_VENDOR_ID, &vendorId);
+        if (address.empty()) {
+            note = "PCI address unknown";
+        } else if (vendorId == 0x10de) {
+            const NvmlApi& nvml = nvml_api();
+            void* handle = nullptr;
+            if (!nvml.loaded) {
+                note = "libnvidia-ml.so.1 not available";
+            } else if (nvml.deviceGetHandleByPciBusId(address.c_str(), &handle) == 0) {
+                EnergyCounter counter;
+                counter.label = "nvml";
+                counter.nvmlDevice = handle;
+                unsigned long long millijoules = 0;
+                counter.cumulative = nvml.deviceGetTotalEnergyConsumption &&
+                                     nvml.deviceGetTotalEnergyConsumption(handle, &millijoules) == 0;
+                if (counter.cumulative || nvml.deviceGetPowerUsage) {
+                    counter.label += counter.cumulative ? " energy" : " power";
+                    counters.push_back(counter);
+                }
+            } else {
+                note = "NVML has no device at " + address;
+            }
+        } else {
+            // Prefer a cumulative energy counter; otherwise integrate the averaged or instantaneous power
+            for (const auto& entry : fs::directory_iterator("/sys/bus/pci/devices/" + address + "/hwmon", ec)) {
+                std::string hwmon = entry.path().string();
+                std::string name = read_sysfs(hwmon + "/name");
+                for (const char* file : {"energy1_input", "power1_average", "power1_input"}) {
+                    if (!fs::exists(hwmon + "/" + file, ec)) continue;
+                    EnergyCounter counter;
+                    counter.label = "hwmon " + name + " " + file;
+                    counter.path = hwmon + "/" + file;
+                    counter.cumulative = file[0] == 'e';
+                    counters.push_back(counter);
+                    break;
+                }
+            }
+            if (counters.empty()) note = "no hwmon power sensor for " + address;
+        }
+    }
+    size_t found = counters.size();
+    counters.erase(std::remove_if(counters.begin(), counters.end(),
+                                  [](const EnergyCounter& counter) { return read_energy_counter(counter) < 0.0; }),
+                   counters.end());
+    if (counters.empty() && found > 0) note = "energy counters are not readable (try as root)";
+#else
+    (void)device;
+    note = "energy sampling is Linux only";
+#endif
+    return counters;
+}
+
+// Samples one device's counters on a background thread, so the benchmark thread only takes a lock
+// at phase boundaries, and integrates the joules used since the meter started
+struct EnergyMeter {
+    std::vector<EnergyCounter> counters;
+    std::string source;          // Labels of the counters, for the report
+    std::chrono::milliseconds interval{20};
+    std::chrono::steady_clock::time_point startTime, lastSample;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    double joules = 0.0;
+
+    ~EnergyMeter() {
+        if (!thread.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        thread.join();
+    }
+};
+
+// Energy used and time covered by the meter's samples so far
+struct EnergyReading {
+    double joules = 0.0;
+    double seconds = 0.0;
+};
+
+// Reads every counter and adds the energy since the previous sample; power counters are
+// integrated with the trapezoidal rule. Only the sampling thread calls this once it runs.
+static void sample_energy(EnergyMeter& meter) {
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - meter.lastSample).count();
+    double joules = 0.0;
+    for (auto& counter : meter.counters) {
+        double value = read_energy_counter(counter);
+        if (value < 0.0) continue;
+        if (counter.last >= 0.0) {
+            if (counter.cumulative) {
+                double delta = value - counter.last;
+                if (delta < 0.0) delta += counter.wrapUj;
+                if (delta > 0.0) joules += delta * 1e-6;
+            } else {
+                joules += 0.5 * (value + counter.last) * seconds;
+            }
+        }
+        counter.last = value;
+    }
+    std::lock_guard<std::mutex> lock(meter.mutex);
+    meter.joules += joules;
+    meter.lastSample = now;
+}
+
+// Starts sampling the counters of `device` every intervalMs; false (with the reason printed) if it has none
+bool start_energy_meter(EnergyMeter& meter, const cl::Device& device, int intervalMs) {
+    std::string note;
+    meter.counters = find_energy_counters(device, note);
+    if (meter.counters.empty()) {
+        std::cout << "\nEnergy sampling unavailable: " << note << std::endl;
+        return false;
+    }
+    for (const auto& counter : meter.counters) {
+        meter.source += (meter.source.empty() ? "" : ", ") + counter.label;
+    }
+    meter.interval = std::chrono::milliseconds(intervalMs);
+    meter.startTime = meter.lastSample = std::chrono::steady_clock::now();
+    sample_energy(meter);
+    meter.thread = std::thread([&meter] {
+        std::unique_lock<std::mutex> lock(meter.mutex);
+        while (!meter.wake.wait_for(lock, meter.interval, [&] { return meter.stopping; })) {
+            lock.unlock();
+            sample_energy(meter);
+            lock.lock();
+        }
+    });
+    std::cout << "\nEnergy sampling every " << intervalMs << " ms from " << meter.source << std::endl;
+    return true;
+}
+
+static EnergyReading read_energy(EnergyMeter& meter) {
+    std::lock_guard<std::mutex> lock(meter.mutex);
+    return {meter.joules, std::chrono::duration<double>(meter.lastSample - meter.startTime).count()};
+}
+
+// Attributes the energy of one run_benchmark phase: when the phase finishes, prints its joules and
+// average power and stores that power in every record the phase appended. A null meter does nothing.
+struct EnergyScope {
+    EnergyMeter* meter;
+    std::string phase;
+    std::vector<ResultRecord>& records;
+    size_t firstRecord;
+    EnergyReading start;
+
+    EnergyScope(EnergyMeter* meter, const std::string& phase, std::vector<ResultRecord>& records)
+        : meter(meter), phase(phase), records(records), firstRecord(records.size()) {
+        if (meter) start = read_energy(*meter);
+    }
+    ~EnergyScope() { finish(); }
+
+    void finish() {
+        if (!meter) return;
+        EnergyReading end = read_energy(*meter);
+        meter = nullptr;
+        double joules = end.joules - start.joules;
+        double seconds = end.seconds - start.seconds;
+        if (seconds <= 0.0) {
+            std::cout << "Energy (" << phase << "): shorter than the sampling interval" << std::endl;
+            return;
+        }
+        double watts = joules / seconds;
+        std::cout << "Energy (" << phase << "): " << joules << " J over " << seconds << " s, "
+                  << watts << " W average" << std::endl;
+        for (size_t i = firstRecord; i < records.size(); ++i) records[i].watts = watts;
+    }
+};
+
+// Joules per GB moved and GOP/s per watt of the kernel and overall timings that have a power figure
+void print_energy_efficiency(const std::vector<ResultRecord>& records, size_t firstRecord) {
+    std::cout << "\n--- Energy Efficiency (average power of the phase each result ran in) ---" << std::endl;
+    std::cout << std::left << std::setw(12) << "Test" << std::setw(16) << "Strategy" << std::setw(22) << "Kernel"
+              << std::setw(9) << "Phase" << std::right
+              << std::setw(13) << "Median (ms)"
+              << std::setw(10) << "GB/s"
+              << std::setw(10) << "W"
+              << std::setw(10) << "J/GB"
+              << std::setw(12) << "GOP/s/W" << std::endl;
+    for (size_t i = firstRecord; i < records.size(); ++i) {
+        const ResultRecord& record = records[i];
+        if (record.watts <= 0.0 || (record.phase != "kernel" && record.phase != "overall")) continue;
+        double gbps = gb_per_s(record.bytes, record.stats.median);
+        double gops = gb_per_s(record.ops > 0.0 ? record.ops : (double)record.elements, record.stats.median);
+        std::cout << std::left << std::setw(12) << record.test << std::setw(16) << record.strategy
+                  << std::setw(22) << record.kernel << std::setw(9) << record.phase << std::right
+                  << std::setw(13) << record.stats.median
+                  << std::setw(10) << gbps
+                  << std::setw(10) << record.watts
+                  << std::setw(10) << (gbps > 0.0 ? record.watts / gbps : 0.0)
+                  << std::setw(12) << gops / record.watts << std::endl;
+    }
 }
 
 // Function to run benchmark on a specific OpenCL device
-void run_benchmark(const cl::Platform& platform, const cl::Device& device) {
+void run_benchmark(const cl::Platform& platform, const cl::Device& device, const BenchmarkOptions& options,
+                   const HostBaseline* hostBaseline, TraceLog* trace, std::vector<ResultRecord>& records) {
     std::string deviceName;
     device.getInfo(CL_DEVICE_NAME, &deviceName);
     std::string platformName;
@@ -40,127 +5489,1120 @@ void run_benchmark(const cl::Platform& platform, const cl::Device& device) {
     std::cout << "--- Benchmarking Device: " << deviceName
               << " (Platform: " << platformName << ") ---" << std::endl;
 
-    cl_int err;
-
     // --- 1. Create Context and Command Queue ---
-    cl::Context context(device);
-    // Enable profiling on the command queue to measure execution times
-    cl::CommandQueue queue(context, device, CL_QUEUE_PROFILING_ENABLE, &err);
-    if (err != CL_SUCCESS) {
-        print_cl_error(err);
-        std::cerr << "Failed to create command queue for device: " << deviceName << std::endl;
+    // The session outlives every trial below so setup is paid once and reported on its own
+    DeviceSession session;
+    if (!open_session(device, session)) {
+        std::cerr << "Failed to set up device: " << deviceName << std::endl;
         return;
     }
+    const cl::Context& context = session.context;
+    const cl::CommandQueue& queue = session.queue;
+    trace_queue(trace, device, queue, "queue", &session.clock);
 
     // --- 2. Build the OpenCL Program ---
-    cl::Program program(context, opencl_kernel);
-    err = program.build({device});
-    if (err != CL_SUCCESS) {
-        print_cl_error(err);
-        std::cerr << "Failed to build kernel program for device: " << deviceName << std::endl;
-        // Print build log for debugging if building fails
-        std::string buildLog;
-        program.getBuildInfo(device, CL_PROGRAM_BUILD_LOG, &buildLog);
-        std::cerr << "Build Log:\n" << buildLog << std::endl;
+    cl::Program program;
+    BuildStats buildStats;
+    if (!session_program(session, opencl_kernel, "", options, program, buildStats)) {
         return;
     }
+    print_build_stats(buildStats);
 
-    // --- 3. Prepare Host Data ---
-    const int DATA_SIZE = 1024 * 1024; // 1M elements for demonstration (approx. 4MB)
-    std::vector<int> h_A(DATA_SIZE, 1);
-    std::vector<int> h_B(DATA_SIZE, 2);
-    std::vector<int> h_C(DATA_SIZE); // Result vector
+    DevicePeaks peaks = lookup_device_peaks(device, deviceName, options);
+    print_device_peaks(peaks);
 
-    // --- 4. Create Device Buffers ---
-    // CL_MEM_READ_ONLY / CL_MEM_WRITE_ONLY: Hints for memory access patterns
-    // CL_MEM_HOST_WRITE_ONLY / CL_MEM_HOST_READ_ONLY: Hints for host access patterns
-    cl::Buffer d_A(context, CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY, sizeof(int) * DATA_SIZE, nullptr, &err);
-    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create buffer d_A." << std::endl; return; }
-    cl::Buffer d_B(context, CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY, sizeof(int) * DATA_SIZE, nullptr, &err);
-    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create buffer d_B." << std::endl; return; }
-    cl::Buffer d_C(context, CL_MEM_WRITE_ONLY | CL_MEM_HOST_READ_ONLY, sizeof(int) * DATA_SIZE, nullptr, &err);
-    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create buffer d_C." << std::endl; return; }
+    // Reuse tuned local sizes from earlier runs; --autotune only sweeps kernels missing from the cache
+    TuningCache tuningCache = load_tuning_cache(options.tuningCachePath);
+    if (options.autotune) {
+        bool updated = false;
+        for (KernelVariant variant : options.variants) {
+            KernelVariant resolved = resolve_variant(device, variant);
+            std::string key = tuning_key(platform, device, variant_kernel_name(resolved));
+            if (!options.retune && tuningCache.count(key)) {
+                std::cout << "\nUsing cached local size " << tuningCache[key] << " for "
+                          << variant_kernel_name(resolved) << " (--retune to sweep again)" << std::endl;
+                continue;
+            }
+            size_t best = autotune_local_size(device, context, queue, program, resolved, options);
+            if (best > 0) {
+                tuningCache[key] = best;
+                updated = true;
+            }
+        }
+        if (updated) save_tuning_cache(options.tuningCachePath, tuningCache);
+    }
 
-    // --- 5. Create Kernel Object and Set Arguments ---
-    cl::Kernel kernel(program, "vecadd", &err);
-    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create kernel 'vecadd'." << std::endl; return; }
-    kernel.setArg(0, d_A);
-    kernel.setArg(1, d_B);
-    kernel.setArg(2, d_C);
-    kernel.setArg(3, DATA_SIZE);
+    DeviceIdentity identity = device_identity(platform, device);
+    size_t firstRecord = records.size();
+    EnergyMeter energyMeter;
+    EnergyMeter* meter = options.energy && start_energy_meter(energyMeter, device, options.energyIntervalMs) ? &energyMeter : nullptr;
 
-    // --- 6. Perform Benchmark Operations ---
-    cl::Event writeEventA, writeEventB, kernelEvent, readEventC;
+    std::vector<PipelineResult> results;
+    EnergyScope pipelineEnergy(meter, options.sweep ? "sweep" : "pipeline", records);
+    for (BufferStrategy strategy : options.strategies) {
+        if (!strategy_supported(device, strategy)) {
+            std::cout << "\nSkipping " << strategy_name(strategy) << ": not supported by this device." << std::endl;
+            continue;
+        }
+        for (KernelVariant variant : options.variants) {
+            PipelineConfig config;
+            config.strategy = strategy;
+            config.variant = resolve_variant(device, variant);
+            auto tuned = tuningCache.find(tuning_key(platform, device, variant_kernel_name(config.variant)));
+            if (tuned != tuningCache.end()) config.localSize = tuned->second;
+            if (options.sweep) {
+                for (const auto& result : run_size_sweep(device, context, queue, program, &session.pool, trace, session.clock, config, options)) {
+                    append_pipeline_records(records, identity, "sweep", result);
+                }
+                continue;
+            }
+
+            PipelineResult result;
+            if (run_pipeline(device, context, queue, program, &session.pool, trace, session.clock, DATA_SIZE, config, options, result)) {
+                print_pipeline_result(result, peaks, options);
+                append_pipeline_records(records, identity, "pipeline", result);
+                results.push_back(result);
+            }
+        }
+    }
+    pipelineEnergy.finish();
+    if (results.size() > 1) {
+        print_config_comparison(results);
+    }
+    if (hostBaseline) {
+        print_host_comparison(results, *hostBaseline);
+    }
+    if (options.pinned) {
+        EnergyScope energy(meter, "pinned", records);
+        run_pinned_comparison(device, context, queue, options);
+    }
+    if (options.streamChunks > 0) {
+        EnergyScope energy(meter, "streaming", records);
+        run_streaming_pipeline(device, context, queue, program, trace, options);
+    }
+    if (options.launchCount > 0) {
+        EnergyScope energy(meter, "launch overhead", records);
+        run_launch_overhead(context, queue, program, trace, options, identity, records);
+    }
+    if (options.batchJobs > 0) {
+        EnergyScope energy(meter, "batched submission", records);
+        run_batched_submission(device, context, queue, program, trace, options, identity, records);
+    }
+    if (!options.dataTypes.empty()) {
+        EnergyScope energy(meter, "type matrix", records);
+        run_type_matrix(session, options, identity, records);
+    }
+    if (options.roofline) {
+        EnergyScope energy(meter, "roofline", records);
+        run_roofline(context, queue, program, &session.pool, options, identity, records);
+    }
+    if (options.concurrencyStreams > 0) {
+        EnergyScope energy(meter, "concurrency", records);
+        run_concurrency(device, context, program, trace, options, identity, records);
+    }
+    if (options.deviceCopies) {
+        EnergyScope energy(meter, "device copies", records);
+        run_device_copies(queue, session.pool, trace, peaks, options, identity, records);
+    }
+    if (options.outOfCore) {
+        EnergyScope energy(meter, "out-of-core", records);
+        run_out_of_core(device, context, program, trace, options, identity, records);
+    }
+    if (!options.fileDir.empty()) {
+        EnergyScope energy(meter, "file I/O", records);
+        run_file_io(context, queue, program, options, identity, records);
+    }
+    if (options.accessPatterns) {
+        EnergyScope energy(meter, "access patterns", records);
+        run_access_patterns(context, queue, program, options, identity, records);
+    }
+    if (options.reductions) {
+        EnergyScope energy(meter, "reductions", records);
+        run_reductions(session, options, identity, records);
+    }
+    if (options.specialize) {
+        EnergyScope energy(meter, "specialization", records);
+        run_specialization(session, options, identity, records);
+    }
+    if (meter) {
+        print_energy_efficiency(records, firstRecord);
+    }
+
+    // Programs, kernels and buffers must all be gone before the context can really be released
+    program = cl::Program();
+    double teardownMs = close_session(session);
+    print_session_stats(session, teardownMs);
+    // Removed the ~~~~~ separator from here as per request
+}
 
-    // Data transfer: Host to Device (non-blocking)
-    auto start_overall = std::chrono::high_resolution_clock::now();
-    queue.enqueueWriteBuffer(d_A, CL_FALSE, 0, sizeof(int) * DATA_SIZE, h_A.data(), nullptr, &writeEventA);
-    queue.enqueueWriteBuffer(d_B, CL_FALSE, 0, sizeof(int) * DATA_SIZE, h_B.data(), nullptr, &writeEventB);
+// Per-device state for the concurrent multi-device run; buffers hold the whole problem so the
+// same worker can run alone or on its slice
+struct DeviceWorker {
+    cl::Device device;
+    std::string name;
+    cl::Context context;
+    cl::CommandQueue queue;
+    cl::Program program;
+    cl::Kernel kernel;
+    cl::Buffer d_A, d_B, d_C;
+    int offset = 0;
+    int count = 0;
+    double share = 0.0;
+    PhaseStats alone;
+    bool aloneCorrect = false;
+    PhaseStats concurrent;
+};
 
-    // Enqueue Kernel (waits for write events to complete)
-    std::vector<cl::Event> writeEvents = {writeEventA, writeEventB};
-    cl::NDRange globalWorkSize(DATA_SIZE);
-    // cl::NullRange lets OpenCL automatically choose a local work size.
-    queue.enqueueNDRangeKernel(kernel, cl::NullRange, globalWorkSize, cl::NullRange, &writeEvents, &kernelEvent);
+// Creates the context, queue, program and full-size buffers of one worker
+static bool setup_device_worker(const cl::Device& device, int elements, const BenchmarkOptions& options,
+                                DeviceWorker& worker) {
+    cl_int err;
+    worker.device = device;
+    device.getInfo(CL_DEVICE_NAME, &worker.name);
+    worker.context = cl::Context(device);
+    worker.queue = cl::CommandQueue(worker.context, device, CL_QUEUE_PROFILING_ENABLE, &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create command queue for device: " << worker.name << std::endl; return false; }
+    BuildStats buildStats;
+    if (!build_program(worker.context, device, opencl_kernel, "", options, worker.program, buildStats)) return false;
 
-    // Data transfer: Device to Host (blocking, waits for kernel completion)
+    size_t bytes = sizeof(int) * elements;
+    worker.d_A = cl::Buffer(worker.context, CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY, bytes, nullptr, &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create buffer d_A." << std::endl; return false; }
+    worker.d_B = cl::Buffer(worker.context, CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY, bytes, nullptr, &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create buffer d_B." << std::endl; return false; }
+    worker.d_C = cl::Buffer(worker.context, CL_MEM_WRITE_ONLY | CL_MEM_HOST_READ_ONLY, bytes, nullptr, &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create buffer d_C." << std::endl; return false; }
+    worker.kernel = cl::Kernel(worker.program, "vecadd", &err);
+    if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create kernel 'vecadd'." << std::endl; return false; }
+    worker.kernel.setArg(0, worker.d_A);
+    worker.kernel.setArg(1, worker.d_B);
+    worker.kernel.setArg(2, worker.d_C);
+    return true;
+}
+
+// Runs write -> vecadd -> read over elements [offset, offset + count) of the shared host arrays
+static bool run_worker_pass(DeviceWorker& worker, const HostVector& h_A, const HostVector& h_B, HostVector& h_C,
+                            int offset, int count, TraceLog* trace) {
+    cl_int err;
+    size_t bytes = sizeof(int) * count;
+    cl::Event writeEventA, writeEventB, kernelEvent, readEventC;
+    double startNs = steady_ns();
+
+    err = worker.queue.enqueueWriteBuffer(worker.d_A, CL_FALSE, 0, bytes, h_A.data() + offset, nullptr, &writeEventA);
+    if (err != CL_SUCCESS) { print_cl_error(err); return false; }
+    err = worker.queue.enqueueWriteBuffer(worker.d_B, CL_FALSE, 0, bytes, h_B.data() + offset, nullptr, &writeEventB);
+    if (err != CL_SUCCESS) { print_cl_error(err); return false; }
+    std::vector<cl::Event> writeEvents = {writeEventA, writeEventB};
+    worker.kernel.setArg(3, count);
+    err = worker.queue.enqueueNDRangeKernel(worker.kernel, cl::NullRange, cl::NDRange(count), cl::NullRange, &writeEvents, &kernelEvent);
+    if (err != CL_SUCCESS) { print_cl_error(err); return false; }
     std::vector<cl::Event> kernelDependencies = {kernelEvent};
-    queue.enqueueReadBuffer(d_C, CL_TRUE, 0, sizeof(int) * DATA_SIZE, h_C.data(), &kernelDependencies, &readEventC);
-
-    // Finish all commands in the queue to ensure profiling data is available
-    queue.finish();
-
-    auto end_overall = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double, std::milli> overall_ms = end_overall - start_overall;
-
-    // --- 7. Get Profiling Info ---
-    cl_ulong timeStart_writeA, timeEnd_writeA;
-    cl_ulong timeStart_writeB, timeEnd_writeB;
-    cl_ulong timeStart_kernel, timeEnd_kernel;
-    cl_ulong timeStart_readC, timeEnd_readC;
-
-    writeEventA.getProfilingInfo(CL_PROFILING_COMMAND_START, &timeStart_writeA);
-    writeEventA.getProfilingInfo(CL_PROFILING_COMMAND_END, &timeEnd_writeA);
-
-    writeEventB.getProfilingInfo(CL_PROFILING_COMMAND_START, &timeStart_writeB);
-    writeEventB.getProfilingInfo(CL_PROFILING_COMMAND_END, &timeEnd_writeB);
-
-    kernelEvent.getProfilingInfo(CL_PROFILING_COMMAND_START, &timeStart_kernel);
-    kernelEvent.getProfilingInfo(CL_PROFILING_COMMAND_END, &timeEnd_kernel);
-
-    readEventC.getProfilingInfo(CL_PROFILING_COMMAND_START, &timeStart_readC);
-    readEventC.getProfilingInfo(CL_PROFILING_COMMAND_END, &timeEnd_readC);
-
-    double writeAMs = (double)(timeEnd_writeA - timeStart_writeA) * 1e-6;
-    double writeBMs = (double)(timeEnd_writeB - timeStart_writeB) * 1e-6;
-    double kernelMs = (double)(timeEnd_kernel - timeStart_kernel) * 1e-6;
-    double readCMs = (double)(timeEnd_readC - timeStart_readC) * 1e-6;
-
-    std::cout << "\n--- Benchmark Results (" << DATA_SIZE << " elements) ---" << std::endl;
-    std::cout << "Data Size: " << DATA_SIZE * sizeof(int) / (1024.0 * 1024.0) << " MB" << std::endl;
-    std::cout << "Write A (Host -> Device): " << writeAMs << " ms" << std::endl;
-    std::cout << "Write B (Host -> Device): " << writeBMs << " ms" << std::endl;
-    std::cout << "Kernel Execution Time:    " << kernelMs << " ms" << std::endl;
-    std::cout << "Read C (Device -> Host):  " << readCMs << " ms" << std::endl;
-    std::cout << "Total Overall Time (measured by host clock): " << overall_ms.count() << " ms" << std::endl;
-
-    // --- 8. Verify Results (Optional) ---
-    bool correct = true;
-    for (int i = 0; i < 10 && i < DATA_SIZE; ++i) { // Check first 10 elements
-        if (h_C[i] != (h_A[i] + h_B[i])) {
-            correct = false;
-            break;
+    err = worker.queue.enqueueReadBuffer(worker.d_C, CL_TRUE, 0, bytes, h_C.data() + offset, &kernelDependencies, &readEventC);
+    if (err != CL_SUCCESS) { print_cl_error(err); return false; }
+    worker.queue.finish();
+    if (trace) {
+        double endNs = steady_ns();
+        trace_host_span(trace, worker.queue, "worker pass", startNs, endNs);
+        trace_commands(trace, {{&worker.queue, "write A", writeEventA}, {&worker.queue, "write B", writeEventB},
+                               {&worker.queue, "vecadd", kernelEvent}, {&worker.queue, "read C", readEventC}}, endNs);
+    }
+    return true;
+}
+
+// Runs all devices at the same time on one shared problem, split either by the --split ratios or by
+// the throughput each device achieved alone, and reports aggregate throughput and load imbalance.
+// Records go under test "multi_device": "alone" and "concurrent" per device, and one "aggregate"
+// tagged with every device's name.
+void run_multi_device(const std::vector<cl::Platform>& platforms, const std::vector<cl::Device>& devices,
+                      const BenchmarkOptions& options, TraceLog* trace, std::vector<ResultRecord>& records) {
+    int elements = (int)std::min<size_t>(options.multiDeviceBytes / sizeof(int), INT_MAX);
+    HostVector h_A(elements, 1);
+    HostVector h_B(elements, 2);
+    HostVector h_C(elements);
+
+    std::vector<DeviceWorker> workers(devices.size());
+    for (size_t i = 0; i < devices.size(); ++i) {
+        if (!setup_device_worker(devices[i], elements, options, workers[i])) return;
+        trace_queue(trace, workers[i].device, workers[i].queue, "multi-device queue");
+    }
+
+    // --- Each device alone on the whole problem ---
+    for (auto& worker : workers) {
+        std::vector<double> samples;
+        for (int iter = 0; iter < options.warmupIterations + options.iterations; ++iter) {
+            if (iter == options.warmupIterations + options.iterations - 1) std::fill(h_C.begin(), h_C.end(), VERIFY_POISON);
+            auto start = std::chrono::steady_clock::now();
+            if (!run_worker_pass(worker, h_A, h_B, h_C, 0, elements, trace)) {
+                std::cerr << "Single-device run failed on " << worker.name << std::endl;
+                return;
+            }
+            auto end = std::chrono::steady_clock::now();
+            if (iter >= options.warmupIterations) samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
         }
+        worker.alone = compute_stats(samples);
+        worker.aloneCorrect = verify_vecadd(h_A.data(), h_B.data(), h_C.data(), elements).correct;
     }
-    if (correct) {
-        std::cout << "Result verification: PASSED (first 10 elements are correct)" << std::endl;
-    } else {
-        std::cout << "Result verification: FAILED" << std::endl;
+
+    // --- Split the problem ---
+    std::vector<double> weights;
+    bool learned = options.splitRatios.empty();
+    for (size_t i = 0; i < workers.size(); ++i) {
+        if (learned) {
+            weights.push_back(workers[i].alone.median > 0.0 ? 1.0 / workers[i].alone.median : 0.0);
+        } else {
+            weights.push_back(i < options.splitRatios.size() ? options.splitRatios[i] : 0.0);
+        }
     }
-    // Removed the ~~~~~ separator from here as per request
+    double weightSum = std::accumulate(weights.begin(), weights.end(), 0.0);
+    if (weightSum <= 0.0) {
+        std::cerr << "Split ratios sum to zero." << std::endl;
+        return;
+    }
+    int offset = 0;
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].share = weights[i] / weightSum;
+        workers[i].offset = offset;
+        // The last device takes the remainder so every element is covered exactly once
+        workers[i].count = (i + 1 == workers.size()) ? elements - offset : (int)(elements * workers[i].share);
+        offset += workers[i].count;
+    }
+
+    // --- All devices at once ---
+    std::vector<double> aggregateSamples;
+    std::vector<std::vector<double>> workerSamples(workers.size());
+    for (int iter = 0; iter < options.warmupIterations + options.iterations; ++iter) {
+        // Poison before the verified last pass so a slice that is never read back shows up
+        if (iter == options.warmupIterations + options.iterations - 1) std::fill(h_C.begin(), h_C.end(), VERIFY_POISON);
+        Barrier startLine((int)workers.size());
+        std::vector<std::chrono::steady_clock::time_point> starts(workers.size()), ends(workers.size());
+        std::vector<char> ok(workers.size(), 0);
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < workers.size(); ++i) {
+            threads.emplace_back([&, i] {
+                startLine.arrive_and_wait();
+                starts[i] = std::chrono::steady_clock::now();
+                ok[i] = workers[i].count == 0 ||
+                        run_worker_pass(workers[i], h_A, h_B, h_C, workers[i].offset, workers[i].count, trace);
+                ends[i] = std::chrono::steady_clock::now();
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        for (size_t i = 0; i < workers.size(); ++i) {
+            if (!ok[i]) {
+                std::cerr << "Concurrent run failed on " << workers[i].name << std::endl;
+                return;
+            }
+        }
+        if (iter < options.warmupIterations) continue;
+
+        auto first = *std::min_element(starts.begin(), starts.end());
+        auto last = *std::max_element(ends.begin(), ends.end());
+        aggregateSamples.push_back(std::chrono::duration<double, std::milli>(last - first).count());
+        for (size_t i = 0; i < workers.size(); ++i) {
+            workerSamples[i].push_back(std::chrono::duration<double, std::milli>(ends[i] - starts[i]).count());
+        }
+    }
+    for (size_t i = 0; i < workers.size(); ++i) workers[i].concurrent = compute_stats(workerSamples[i]);
+    PhaseStats aggregate = compute_stats(aggregateSamples);
+
+    // --- Report ---
+    double totalBytes = 3.0 * sizeof(int) * (double)elements;
+    std::cout << "\n--- Multi-Device Concurrent Run (" << elements * sizeof(int) / (1024.0 * 1024.0) << " MB, "
+              << workers.size() << " devices, " << (learned ? "learned" : "static") << " split, median of "
+              << options.iterations << " iterations) ---" << std::endl;
+    std::cout << std::left << std::setw(48) << "Device" << std::right
+              << std::setw(10) << "Share"
+              << std::setw(14) << "Alone (ms)"
+              << std::setw(18) << "Concurrent (ms)" << std::endl;
+    double fastestAlone = 0.0, slowestConcurrent = 0.0, fastestConcurrent = 0.0;
+    for (size_t i = 0; i < workers.size(); ++i) {
+        const auto& worker = workers[i];
+        std::cout << std::left << std::setw(48) << worker.name.substr(0, 47) << std::right
+                  << std::setw(9) << worker.share * 100.0 << "%"
+                  << std::setw(14) << worker.alone.median
+                  << std::setw(18) << worker.concurrent.median << std::endl;
+        if (i == 0 || worker.alone.median < fastestAlone) fastestAlone = worker.alone.median;
+        if (worker.count == 0) continue;
+        if (worker.concurrent.median > slowestConcurrent) slowestConcurrent = worker.concurrent.median;
+        if (fastestConcurrent == 0.0 || worker.concurrent.median < fastestConcurrent) fastestConcurrent = worker.concurrent.median;
+    }
+    std::cout << "Aggregate: " << aggregate.median << " ms (" << gb_per_s(totalBytes, aggregate.median)
+              << " GB/s end-to-end, " << (aggregate.median > 0.0 ? fastestAlone / aggregate.median : 0.0)
+              << "x vs fastest single device)" << std::endl;
+    // 0% means every device finished at the same time; 50% means the fastest one idled half the run
+    std::cout << "Load imbalance: "
+              << (slowestConcurrent > 0.0 ? (slowestConcurrent - fastestConcurrent) / slowestConcurrent * 100.0 : 0.0)
+              << "% (slowest vs fastest device)" << std::endl;
+
+    VerifyResult verify = verify_vecadd(h_A.data(), h_B.data(), h_C.data(), elements);
+    std::cout << "Result verification: " << describe_verification(verify) << std::endl;
+
+    auto record_phase = [&](const DeviceIdentity& identity, const char* strategy, int count, const PhaseStats& stats,
+                            bool correct) {
+        ResultRecord record;
+        record.identity = identity;
+        record.test = "multi_device";
+        record.strategy = strategy;
+        record.kernel = "vecadd";
+        record.elements = count;
+        record.phase = "overall";
+        record.bytes = 3.0 * sizeof(int) * (double)count;
+        record.stats = stats;
+        record.verified = correct;
+        records.push_back(record);
+    };
+    DeviceIdentity combined;
+    for (size_t i = 0; i < workers.size(); ++i) {
+        DeviceIdentity identity = device_identity(platforms[i], workers[i].device);
+        record_phase(identity, "alone", elements, workers[i].alone, workers[i].aloneCorrect);
+        if (workers[i].count > 0) record_phase(identity, "concurrent", workers[i].count, workers[i].concurrent, verify.correct);
+        const char* separator = i == 0 ? "" : " + ";
+        if (combined.platform.find(identity.platform) == std::string::npos) {
+            combined.platform += (combined.platform.empty() ? "" : " + ") + identity.platform;
+        }
+        combined.device += separator + identity.device;
+        combined.driver += separator + identity.driver;
+    }
+    record_phase(combined, "aggregate", elements, aggregate, verify.correct);
+}
+
+// Host wall time of `transfer` over warmup + measured passes, after an untimed `prepare(iter)`
+// that puts fresh content into the source; `check(iter)` verifies the last pass
+template <typename Prepare, typename Transfer, typename Check>
+static bool time_peer_transfer(const BenchmarkOptions& options, Prepare prepare, Transfer transfer, Check check,
+                               PhaseStats& stats, bool& correct) {
+    std::vector<double> samples;
+    int totalIterations = options.warmupIterations + options.iterations;
+    for (int iter = 0; iter < totalIterations; ++iter) {
+        if (!prepare(iter)) return false;
+        auto start = std::chrono::steady_clock::now();
+        if (!transfer()) return false;
+        auto end = std::chrono::steady_clock::now();
+        if (iter == totalIterations - 1) correct = check(iter);
+        if (iter >= options.warmupIterations) samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    stats = compute_stats(samples);
+    return true;
+}
+
+// Moves options.transferBytes from every selected device to every other one: staged through host
+// memory between two contexts, with enqueueCopyBuffer inside one context shared by both devices,
+// and with enqueueMigrateMemObjects in that shared context. The last two need one platform.
+void run_peer_transfers(const std::vector<cl::Platform>& platforms, const std::vector<cl::Device>& devices,
+                        const BenchmarkOptions& options, std::vector<ResultRecord>& records) {
+    cl_int err;
+    size_t bytes = options.transferBytes / sizeof(int) * sizeof(int);
+    HostVector staging(bytes / sizeof(int));
+    std::vector<std::string> names(devices.size());
+    for (size_t i = 0; i < devices.size(); ++i) devices[i].getInfo(CL_DEVICE_NAME, &names[i]);
+
+    std::cout << "\n--- Peer Transfers (" << bytes / (1024.0 * 1024.0) << " MB, median of " << options.iterations
+              << " iterations) ---" << std::endl;
+    for (size_t s = 0; s < devices.size(); ++s) {
+        for (size_t d = 0; d < devices.size(); ++d) {
+            if (s == d) continue;
+            const cl::Device& source = devices[s];
+            const cl::Device& destination = devices[d];
+            std::cout << "\n" << names[s] << " -> " << names[d] << std::endl;
+
+            // Each pass fills the source with iter + 1 on the source device, outside the timed window
+            std::vector<std::pair<std::string, PhaseStats>> phases;
+            std::vector<std::pair<std::string, bool>> checks;
+            auto record_phase = [&](const char* strategy, const char* label, const PhaseStats& stats, bool correct) {
+                ResultRecord record;
+                record.identity = device_identity(platforms[d], destination);
+                record.test = "peer";
+                record.strategy = strategy;
+                record.kernel = names[s];
+                record.elements = (long long)(bytes / sizeof(int));
+                record.phase = "overall";
+                record.bytes = (double)bytes;
+                record.stats = stats;
+                record.verified = correct;
+                records.push_back(record);
+                phases.push_back({label, stats});
+                checks.push_back({strategy, correct});
+            };
+
+            // --- Staged: read to host on the source, write from host on the destination ---
+            {
+                cl::Context sourceContext(source), destinationContext(destination);
+                cl::CommandQueue sourceQueue(sourceContext, source, CL_QUEUE_PROFILING_ENABLE, &err);
+                if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create source queue." << std::endl; return; }
+                cl::CommandQueue destinationQueue(destinationContext, destination, CL_QUEUE_PROFILING_ENABLE, &err);
+                if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create destination queue." << std::endl; return; }
+                cl::Buffer d_src(sourceContext, CL_MEM_READ_WRITE, bytes, nullptr, &err);
+                if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create source buffer." << std::endl; return; }
+                cl::Buffer d_dst(destinationContext, CL_MEM_READ_WRITE, bytes, nullptr, &err);
+                if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create destination buffer." << std::endl; return; }
+
+                PhaseStats stats;
+                bool correct = false;
+                bool ok = time_peer_transfer(options,
+                    [&](int iter) { return sourceQueue.enqueueFillBuffer(d_src, iter + 1, 0, bytes) == CL_SUCCESS && sourceQueue.finish() == CL_SUCCESS; },
+                    [&] {
+                        return sourceQueue.enqueueReadBuffer(d_src, CL_TRUE, 0, bytes, staging.data()) == CL_SUCCESS &&
+                               destinationQueue.enqueueWriteBuffer(d_dst, CL_TRUE, 0, bytes, staging.data()) == CL_SUCCESS;
+                    },
+                    [&](int iter) { return buffer_holds(destinationQueue, d_dst, bytes, iter + 1); },
+                    stats, correct);
+                if (!ok) { std::cerr << "Staged transfer failed." << std::endl; return; }
+                record_phase("staged", "Staged through host:", stats, correct);
+            }
+
+            // --- One context holding both devices ---
+            if (platforms[s]() != platforms[d]()) {
+                std::cout << "Shared-context copy and migration skipped: the devices are on different platforms." << std::endl;
+            } else {
+                cl::Context shared(std::vector<cl::Device>{source, destination}, nullptr, nullptr, nullptr, &err);
+                if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create shared context." << std::endl; return; }
+                cl::CommandQueue sourceQueue(shared, source, CL_QUEUE_PROFILING_ENABLE, &err);
+                if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create source queue." << std::endl; return; }
+                cl::CommandQueue destinationQueue(shared, destination, CL_QUEUE_PROFILING_ENABLE, &err);
+                if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create destination queue." << std::endl; return; }
+                cl::Buffer d_src(shared, CL_MEM_READ_WRITE, bytes, nullptr, &err);
+                if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create source buffer." << std::endl; return; }
+                cl::Buffer d_dst(shared, CL_MEM_READ_WRITE, bytes, nullptr, &err);
+                if (err != CL_SUCCESS) { print_cl_error(err); std::cerr << "Failed to create destination buffer." << std::endl; return; }
+                auto prepare = [&](int iter) {
+                    return sourceQueue.enqueueFillBuffer(d_src, iter + 1, 0, bytes) == CL_SUCCESS && sourceQueue.finish() == CL_SUCCESS;
+                };
+
+                // The destination queue copies out of a buffer last written on the source device,
+                // so the runtime has to move the data across
+                PhaseStats stats;
+                bool correct = false;
+                bool ok = time_peer_transfer(options, prepare,
+                    [&] {
+                        return destinationQueue.enqueueCopyBuffer(d_src, d_dst, 0, 0, bytes) == CL_SUCCESS &&
+                               destinationQueue.finish() == CL_SUCCESS;
+                    },
+                    [&](int iter) { return buffer_holds(destinationQueue, d_dst, bytes, iter + 1); },
+                    stats, correct);
+                if (!ok) { std::cerr << "Shared-context copy failed." << std::endl; return; }
+                record_phase("shared-context", "Shared-context copy:", stats, correct);
+
+                ok = time_peer_transfer(options, prepare,
+                    [&] {
+                        return destinationQueue.enqueueMigrateMemObjects({d_src}, 0) == CL_SUCCESS &&
+                               destinationQueue.finish() == CL_SUCCESS;
+                    },
+                    [&](int iter) { return buffer_holds(destinationQueue, d_src, bytes, iter + 1); },
+                    stats, correct);
+                if (!ok) { std::cerr << "Migration failed." << std::endl; return; }
+                record_phase("migrate", "Migrate (shared context):", stats, correct);
+            }
+
+            std::cout << std::left << std::setw(28) << "Phase (ms)" << std::right
+                      << std::setw(11) << "min"
+                      << std::setw(11) << "median"
+                      << std::setw(11) << "p95"
+                      << std::setw(11) << "p99"
+                      << std::setw(11) << "stddev"
+                      << std::setw(10) << "cv" << std::endl;
+            for (const auto& phase : phases) print_phase_stats(phase.first, phase.second);
+            for (const auto& phase : phases) {
+                std::string label = phase.first.substr(0, phase.first.size() - 1) + " bandwidth:";
+                std::cout << std::left << std::setw(37) << label << std::right
+                          << format_rate(gb_per_s((double)bytes, phase.second.median), 0.0) << std::endl;
+            }
+            std::cout << "Result verification:";
+            for (const auto& check : checks) std::cout << " " << check.first << " " << (check.second ? "PASSED" : "FAILED");
+            std::cout << std::endl;
+        }
+    }
+}
+
+// Prints the supported command-line options
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --list                   Only list the selected platforms and devices\n"
+              << "  --platform=SEL           Platforms to use: comma-separated indices or name substrings\n"
+              << "  --device=SEL             Devices to use within each platform: indices or name substrings\n"
+              << "  --device-type=LIST       Comma-separated device types: cpu, gpu, accelerator or all (default all)\n"
+              << "  --sweep                  Run the pipeline over a geometric series of sizes\n"
+              << "  --sweep-min-kb=N         Smallest sweep size in KB (default 4)\n"
+              << "  --sweep-max-fraction=F   Largest sweep size as a fraction of CL_DEVICE_MAX_MEM_ALLOC_SIZE (default 0.25)\n"
+              << "  --sweep-factor=F         Ratio between consecutive sweep sizes (default 2)\n"
+              << "  --warmup=N               Untimed passes before measuring (default 2)\n"
+              << "  --iterations=N           Timed passes per size (default 10)\n"
+              << "  --transfer=LIST          Comma-separated buffer strategies: copy, use-host-ptr, alloc-host-ptr, svm or all (default copy)\n"
+              << "  --kernel=LIST            Comma-separated vecadd variants: scalar, int4, int8, int16, grid-stride,\n"
+              << "                           unroll4, unroll8, vector (preferred int width) or all (default scalar)\n"
+              << "  --autotune               Sweep local work sizes for kernels not in the tuning cache\n"
+              << "  --retune                 Like --autotune, but also re-sweep cached kernels\n"
+              << "  --tune-cache=FILE        Tuned local size cache (default benchmark_tuning.cache)\n"
+              << "  --binary-cache=DIR       Directory for compiled program binaries (default benchmark_binaries)\n"
+              << "  --no-binary-cache        Always build programs from source\n"
+              << "  --host-baseline          Time native scalar, SIMD and multithreaded vecadd on the host for comparison\n"
+              << "  --host-threads=N         Threads for the multithreaded host baseline (default: all allowed CPUs)\n"
+              << "  --pinned                 Compare H2D/D2H bandwidth from pageable vs pinned host memory\n"
+              << "  --launch-overhead[=N]    Measure enqueue cost and launch latency of tiny kernels (N launches, default 10000)\n"
+              << "  --batch=M                Compare ways of submitting M small vecadd jobs (jobs/s)\n"
+              << "  --batch-elements=E       Elements per batched job (default 4096)\n"
+              << "  --types=LIST             Run add and FMA kernels for int, long, float, half, double or all\n"
+              << "  --fma-chain=K            Multiply-adds per element in the FMA kernels (default 256, max 1023)\n"
+              << "  --roofline               Sweep FLOP/byte with an FMA kernel and report the ridge point\n"
+              << "  --roofline-mb=N          Input size of the roofline sweep in MB (default 64)\n"
+              << "  --concurrency=N          Run N independent vecadd streams on 1..N in-order queues and one out-of-order queue\n"
+              << "  --concurrency-elements=E Elements per concurrent stream (default 1048576)\n"
+              << "  --device-copies          Time enqueueCopyBuffer within one device and enqueueFillBuffer\n"
+              << "  --peer                   Time staged, shared-context and migrated transfers between all device pairs\n"
+              << "  --transfer-mb=N          Size of each device and peer transfer in MB (default 64)\n"
+              << "  --out-of-core[=GB]       Stream GB per input (default 1.5x device memory) through a bounded buffer ring\n"
+              << "  --ooc-chunk-mb=N         Size of each out-of-core chunk buffer in MB (default 64)\n"
+              << "  --ooc-slots=K            Out-of-core chunks in flight (default 3)\n"
+              << "  --file-io=DIR            Compare read()/write() and mmap ingest of DIR/a.bin + b.bin into DIR/c.bin\n"
+              << "  --file-mb=N              Size of generated file I/O inputs in MB (default 256)\n"
+              << "  --file-warm              Keep file I/O inputs in the page cache instead of evicting them\n"
+              << "  --access-patterns        Compare strided, gather, scatter, AoS and SoA access with coalesced vecadd\n"
+              << "  --strides=LIST           Element strides of the strided pattern (default 2,4,8,16,32)\n"
+              << "  --access-mb=N            Size of each access-pattern array in MB (default 64)\n"
+              << "  --reductions             Benchmark sum/min/max reductions and exclusive scan per strategy\n"
+              << "  --reduce-elements=E      Elements reduced and scanned (default 4194304)\n"
+              << "  --specialize             Benchmark vecadd built with -D count/type/width/unroll against generic builds\n"
+              << "  --spec-types=LIST        Element types of the specialized kernels (default int)\n"
+              << "  --spec-widths=LIST       Vector widths of the specialized kernels: 1, 2, 4, 8, 16 (default 1,4,8)\n"
+              << "  --spec-unroll=LIST       Vectors per work-item of the specialized kernels (default 1,4)\n"
+              << "  --spec-elements=E        Element count compiled into the specialized kernels (default 1048576)\n"
+              << "  --energy                 Sample device energy (RAPL, NVML or hwmon) and report J/GB and GOP/s/W\n"
+              << "  --energy-interval-ms=N   Energy sampling period in milliseconds (default 20)\n"
+              << "  --stream-chunks=K        Also run the streaming pipeline split into K chunks\n"
+              << "  --stream-queues=N        Streaming queues: 3 or 2 in-order, or 1 out-of-order (default 3)\n"
+              << "  --stream-mb=N            Size of each streamed input in MB (default 64)\n"
+              << "  --multi-device           Run all devices at once on one shared problem instead of one by one\n"
+              << "  --split=R1,R2,...        Static per-device split ratios, or \"learned\" (default)\n"
+              << "  --multi-mb=N             Size of each shared input in MB (default 64)\n"
+              << "  --peak-table=FILE        CSV of \"<device name substring>,<memory GB/s>[,<host link GB/s>]\" peaks\n"
+              << "  --cv-warn=PCT            Warn when a phase's coefficient of variation exceeds PCT% (default 5)\n"
+              << "  --output=FILE            Also write every result as JSON lines (or CSV for *.csv) to FILE\n"
+              << "  --format=FMT             Force the --output format: jsonl or csv\n"
+              << "  --trace=FILE             Write a Chrome trace / Perfetto timeline of all commands to FILE\n"
+              << "  --baseline=FILE          Diff this run against an earlier --output file; exit 1 on regressions\n"
+              << "  --regression-threshold=PCT\n"
+              << "                           Median slowdown that counts as a regression (default 5)\n"
+              << "  --alpha=P                Significance level of the Mann-Whitney test (default 0.05)\n"
+              << "  --verify=MODE            full (compare every element on the host) or checksum (reduce on the device) (default full)\n"
+              << "  --help                   Show this message" << std::endl;
+}
+
+// Returns true if arg has the form "<name>=<value>" and stores the value part
+static bool match_option(const std::string& arg, const std::string& name, std::string& value) {
+    if (arg.compare(0, name.size() + 1, name + "=") != 0) return false;
+    value = arg.substr(name.size() + 1);
+    return true;
+}
+
+// Loads the --peak-table CSV; blank lines and lines starting with '#' are ignored
+static bool load_peak_table(const std::string& path, std::vector<PeakTableEntry>& table) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Cannot open peak table: " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        PeakTableEntry entry;
+        std::string memory, link;
+        std::getline(fields, entry.deviceMatch, ',');
+        std::getline(fields, memory, ',');
+        std::getline(fields, link, ',');
+        entry.memoryGBps = std::strtod(memory.c_str(), nullptr);
+        entry.linkGBps = std::strtod(link.c_str(), nullptr);
+        if (entry.deviceMatch.empty()) continue;
+        table.push_back(entry);
+    }
+    return true;
+}
+
+// Parses a comma-separated list of positive integers for `option`
+static bool parse_int_list(const std::string& list, const char* option, std::vector<int>& values) {
+    values.clear();
+    std::istringstream items(list);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        values.push_back(std::atoi(item.c_str()));
+        if (values.back() < 1) {
+            std::cerr << "Invalid " << option << " value '" << item << "' (must be at least 1)." << std::endl;
+            return false;
+        }
+    }
+    return !values.empty();
+}
+
+// Parses a comma-separated list of element type names (or "all")
+static bool parse_data_types(const std::string& list, std::vector<DataType>& types) {
+    types.clear();
+    std::istringstream items(list);
+    std::string name;
+    while (std::getline(items, name, ',')) {
+        if (name == "all") {
+            types.assign(std::begin(ALL_DATA_TYPES), std::end(ALL_DATA_TYPES));
+            return true;
+        }
+        bool found = false;
+        for (DataType type : ALL_DATA_TYPES) {
+            if (name == data_type_name(type)) {
+                types.push_back(type);
+                found = true;
+            }
+        }
+        if (!found) {
+            std::cerr << "Unknown data type: " << name << std::endl;
+            return false;
+        }
+    }
+    return !types.empty();
+}
+
+// True if a --platform / --device selector picks the entry with this index and name; each
+// comma-separated item is either an index or a case-insensitive name substring
+static bool selector_matches(const std::string& selector, int index, const std::string& name) {
+    if (selector.empty()) return true;
+    auto lower = [](std::string text) {
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        return text;
+    };
+    std::istringstream items(selector);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        if (item.empty()) continue;
+        if (item.find_first_not_of("0123456789") == std::string::npos) {
+            if (std::atoi(item.c_str()) == index) return true;
+        } else if (lower(name).find(lower(item)) != std::string::npos) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Parses a comma-separated list of device types into a CL_DEVICE_TYPE_* mask
+static bool parse_device_types(const std::string& list, cl_device_type& types) {
+    types = 0;
+    std::istringstream items(list);
+    std::string name;
+    while (std::getline(items, name, ',')) {
+        if (name == "cpu") {
+            types |= CL_DEVICE_TYPE_CPU;
+        } else if (name == "gpu") {
+            types |= CL_DEVICE_TYPE_GPU;
+        } else if (name == "accelerator") {
+            types |= CL_DEVICE_TYPE_ACCELERATOR;
+        } else if (name == "all") {
+            types = CL_DEVICE_TYPE_ALL;
+        } else {
+            std::cerr << "Unknown device type: " << name << std::endl;
+            return false;
+        }
+    }
+    if (types == 0) {
+        std::cerr << "--device-type needs at least one type." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Parses a comma-separated list of buffer strategy names (or "all")
+static bool parse_strategies(const std::string& list, std::vector<BufferStrategy>& strategies) {
+    strategies.clear();
+    if (list == "all") {
+        strategies.assign(std::begin(ALL_STRATEGIES), std::end(ALL_STRATEGIES));
+        return true;
+    }
+    size_t pos = 0;
+    while (pos <= list.size()) {
+        size_t comma = list.find(',', pos);
+        std::string name = list.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        bool found = false;
+        for (BufferStrategy strategy : ALL_STRATEGIES) {
+            if (name == strategy_name(strategy)) {
+                strategies.push_back(strategy);
+                found = true;
+            }
+        }
+        if (!found) {
+            std::cerr << "Unknown transfer strategy: " << name << std::endl;
+            return false;
+        }
+        if (comma == std::string::npos) break;
+        pos = comma + 1;
+    }
+    return true;
+}
+
+// Parses a comma-separated list of kernel variant names (or "all")
+static bool parse_variants(const std::string& list, std::vector<KernelVariant>& variants) {
+    variants.clear();
+    if (list == "all") {
+        variants.assign(std::begin(ALL_VARIANTS), std::end(ALL_VARIANTS));
+        return true;
+    }
+    std::istringstream names(list);
+    std::string name;
+    while (std::getline(names, name, ',')) {
+        if (name == variant_name(KernelVariant::PreferredVector)) {
+            variants.push_back(KernelVariant::PreferredVector);
+            continue;
+        }
+        bool found = false;
+        for (KernelVariant variant : ALL_VARIANTS) {
+            if (name == variant_name(variant)) {
+                variants.push_back(variant);
+                found = true;
+            }
+        }
+        if (!found) {
+            std::cerr << "Unknown kernel variant: " << name << std::endl;
+            return false;
+        }
+    }
+    return !variants.empty();
+}
+
+// Parses argv into options; returns false (after printing why) on invalid input
+bool parse_options(int argc, char* argv[], BenchmarkOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::string value;
+        if (arg == "--help") {
+            options.help = true;
+        } else if (arg == "--list") {
+            options.list = true;
+        } else if (match_option(arg, "--platform", value)) {
+            options.platformSelector = value;
+        } else if (match_option(arg, "--device", value)) {
+            options.deviceSelector = value;
+        } else if (match_option(arg, "--device-type", value)) {
+            if (!parse_device_types(value, options.deviceType)) return false;
+        } else if (arg == "--sweep") {
+            options.sweep = true;
+        } else if (match_option(arg, "--sweep-min-kb", value)) {
+            options.sweepMinBytes = std::strtoull(value.c_str(), nullptr, 10) * 1024;
+        } else if (match_option(arg, "--sweep-max-fraction", value)) {
+            options.sweepMaxFraction = std::strtod(value.c_str(), nullptr);
+            if (options.sweepMaxFraction <= 0.0 || options.sweepMaxFraction > 1.0) {
+                std::cerr << "--sweep-max-fraction must be in (0, 1]." << std::endl;
+                return false;
+            }
+        } else if (match_option(arg, "--sweep-factor", value)) {
+            options.sweepFactor = std::strtod(value.c_str(), nullptr);
+            if (options.sweepFactor <= 1.0) {
+                std::cerr << "--sweep-factor must be greater than 1." << std::endl;
+                return false;
+            }
+        } else if (match_option(arg, "--warmup", value)) {
+            options.warmupIterations = std::atoi(value.c_str());
+            if (options.warmupIterations < 0) {
+                std::cerr << "--warmup must not be negative." << std::endl;
+                return false;
+            }
+        } else if (match_option(arg, "--iterations", value)) {
+            options.iterations = std::atoi(value.c_str());
+            if (options.iterations < 1) {
+                std::cerr << "--iterations must be at least 1." << std::endl;
+                return false;
+            }
+        } else if (match_option(arg, "--cv-warn", value)) {
+            options.cvWarnThreshold = std::strtod(value.c_str(), nullptr) / 100.0;
+        } else if (match_option(arg, "--output", value)) {
+            options.outputPath = value;
+        } else if (match_option(arg, "--trace", value)) {
+            options.tracePath = value;
+        } else if (match_option(arg, "--format", value)) {
+            if (value == "jsonl" || value == "json") {
+                options.outputFormat = OutputFormat::JsonLines;
+            } else if (value == "csv") {
+                options.outputFormat = OutputFormat::Csv;
+            } else {
+                std::cerr << "Unknown output format '" << value << "' (expected jsonl or csv)." << std::endl;
+                return false;
+            }
+        } else if (match_option(arg, "--baseline", value)) {
+            options.baselinePath = value;
+        } else if (match_option(arg, "--regression-threshold", value)) {
+            options.regressionThreshold = std::strtod(value.c_str(), nullptr) / 100.0;
+        } else if (match_option(arg, "--alpha", value)) {
+            options.significance = std::strtod(value.c_str(), nullptr);
+            if (options.significance <= 0.0 || options.significance >= 1.0) {
+                std::cerr << "--alpha must be between 0 and 1." << std::endl;
+                return false;
+            }
+        } else if (match_option(arg, "--verify", value)) {
+            if (value == "full") {
+                options.verifyMode = VerifyMode::Full;
+            } else if (value == "checksum") {
+                options.verifyMode = VerifyMode::Checksum;
+            } else {
+                std::cerr << "Unknown verify mode '" << value << "' (expected full or checksum)." << std::endl;
+                return false;
+            }
+        } else if (arg == "--pinned") {
+            options.pinned = true;
+        } else if (arg == "--launch-overhead") {
+            options.launchCount = 10000;
+        } else if (match_option(arg, "--launch-overhead", value)) {
+            options.launchCount = std::atoi(value.c_str());
+            if (options.launchCount < 1) {
+                std::cerr << "--launch-overhead must be at least 1." << std::endl;
+                return false;
+            }
+        } else if (match_option(arg, "--batch", value)) {
+            options.batchJobs = std::atoi(value.c_str());
+            if (options.batchJobs < 1) {
+                std::cerr << "--batch must be at least 1." << std::endl;
+                return false;
+            }
+        } else if (match_option(arg, "--batch-elements", value)) {
+            options.batchElements = std::atoi(value.c_str());
+            if (options.batchElements < 1) {
+                std::cerr << "--batch-elements must be at least 1." << std::endl;
+                return false;
+            }
+        } else if (match_option(arg, "--types", value)) {
+            if (!parse_data_types(value, options.dataTypes)) return false;
+        } else if (match_option(arg, "--fma-chain", value)) {
+            // The chain result 1 + 2K must stay exactly representable in half precision
+            options.fmaChain = std::atoi(value.c_str());
+            if (options.fmaChain < 1 || options.fmaChain > 1023) {
+                std::cerr << "--fma-chain must be between 1 and 1023." << std::endl;
+                return false;
+            }
+        } else if (arg == "--roofline") {
+            options.roofline = true;
+        } else if (match_option(arg, "--roofline-mb", value)) {
+            options.rooflineBytes = std::strtoull(value.c_str(), nullptr, 10) * 1024 * 1024;
+            if (options.rooflineBytes == 0) {
+                std::cerr << "--roofline-mb must be at least 1." << std::endl;
+                return false;
+            }
+        } else if (match_option(arg, "--concurrency", value)) {
+            options.concurrencyStreams = std::atoi(value.c_str());
+            if (options.concurrencyStreams < 1) {
+                std::cerr << "--concurrency must be at least 1." << std::endl;
+                return false;
+            }
+        } else if (match_option(arg, "--concurrency-elements", value)) {
+            options.concurrencyElements = std::atoi(value.c_str());
+            if (options.concurrencyElements < 1) {
+                std::cerr << "--concurrency-elements must be at least 1." << std::endl;
+                return false;
+            }
+        } else if (arg == "--device-copies") {
+            options.deviceCopies = true;
+        } else if (arg == "--peer") {
+            options.peerTransfers = true;
+        } else if (match_option(arg, "--transfer-mb", value)) {
+            options.transferBytes = std::strtoull(value.c_str(), nullptr, 10) * 1024 * 1024;
+            if (options.transferBytes == 0) {
+                std::cerr << "--transfer-mb must be at least 1." << std::endl;
+                return false;
+            }
+        } else if (arg == "--out-of-core") {
+            options.outOfCore = true;
+        } else if (match_option(arg, "--out-of-core", value)) {
+            options.outOfCore = true;
+            options.outOfCoreBytes = (size_t)(std::strtod(value.c_str(), nullptr) * 1024.0 * 1024.0 * 1024.0);
+            if (options.outOfCoreBytes < sizeof(int)) {
+                std::cerr << "--out-of-core must be a positive size in GB." << std::endl;
+                return false;
+            }
+        } else if (match_option(arg, "--ooc-chunk-mb", value)) {
+            options.outOfCoreChunkBytes = std::strtoull(value.c_str(), nullptr, 10) * 1024 * 1024;
+            if (options.outOfCoreChunkBytes == 0) {
+                std::cerr << "--ooc-chunk-mb must be at least 1." << std::endl;
+                return false;
+            }
+        } else if (match_option(arg, "--ooc-slots", value)) {
+            options.outOfCoreSlots = std::atoi(value.c_str());
+            if (options.outOfCoreSlots < 1) {
+                std::cerr << "--ooc-slots must be at least 1." << std::endl;
+                return false;
+            }
+        } else if (match_option(arg, "--file-io", value)) {
+            options.fileDir = value;
+        } else if (match_option(arg, "--file-mb", value)) {
+            options.fileBytes = std::strtoull(value.c_str(), nullptr, 10) * 1024 * 1024;
+            if (options.fileBytes == 0) {
+                std::cerr << "--file-mb must be at least 1." << std::endl;
+                return false;
+            }
+        } else if (arg == "--file-warm") {
+            options.fileWarm = true;
+        } else if (arg == "--access-patterns") {
+            options.accessPatterns = true;
+        } else if (match_option(arg, "--strides", value)) {
+            if (!parse_int_list(value, "--strides", options.accessStrides)) return false;
+        } else if (match_option(arg, "--access-mb", value)) {
+            options.accessBytes = std::strtoull(value.c_str(), nullptr, 10) * 1024 * 1024;
+            if (options.accessBytes == 0) {
+                std::cerr << "--access-mb must be at least 1." << std::endl;
+                return false;
+            }
+        } else if (arg == "--reductions") {
+            options.reductions = true;
+        } else if (match_option(arg, "--reduce-elements", value)) {
+            options.reduceElements = std::atoi(value.c_str());
+            if (options.reduceElements < 1) {
+                std::cerr << "--reduce-elements must be at least 1." << std::endl;
+                return false;
+            }
+        } else if (arg == "--specialize") {
+            options.specialize = true;
+        } else if (match_option(arg, "--spec-types", value)) {
+            if (!parse_data_types(value, options.specTypes)) return false;
+        } else if (match_option(arg, "--spec-widths", value)) {
+            if (!parse_int_list(value, "--spec-widths", options.specWidths)) return false;
+            for (int width : options.specWidths) {
+                if (width != 1 && width != 2 && width != 4 && width != 8 && width != 16) {
+                    std::cerr << "Invalid vector width " << width << " (must be 1, 2, 4, 8 or 16)." << std::endl;
+                    return false;
+                }
+            }
+        } else if (match_option(arg, "--spec-unroll", value)) {
+            if (!parse_int_list(value, "--spec-unroll", options.specUnrolls)) return false;
+        } else if (match_option(arg, "--spec-elements", value)) {
+            options.specElements = std::atoi(value.c_str());
+            if (options.specElements < 1) {
+                std::cerr << "--spec-elements must be at least 1." << std::endl;
+                return false;
+            }
+        } else if (arg == "--energy") {
+            options.energy = true;
+        } else if (match_option(arg, "--energy-interval-ms", value)) {
+            options.energyIntervalMs = std::atoi(value.c_str());
+            if (options.energyIntervalMs < 1) {
+                std::cerr << "--energy-interval-ms must be at least 1." << std::endl;
+                return false;
+            }
+        } else if (match_option(arg, "--stream-chunks", value)) {
+            options.streamChunks = std::atoi(value.c_str());
+            if (options.streamChunks < 1) {
+                std::cerr << "--stream-chunks must be at least 1." << std::endl;
+                return false;
+            }
+        } else if (match_option(arg, "--stream-queues", value)) {
+            options.streamQueues = std::atoi(value.c_str());
+            if (options.streamQueues < 1 || options.streamQueues > 3) {
+                std::cerr << "--stream-queues must be 1, 2 or 3." << std::endl;
+                return false;
+            }
+        } else if (match_option(arg, "--stream-mb", value)) {
+            options.streamBytes = std::strtoull(value.c_str(), nullptr, 10) * 1024 * 1024;
+            if (options.streamBytes == 0) {
+                std::cerr << "--stream-mb must be at least 1." << std::endl;
+                return false;
+            }
+        } else if (arg == "--multi-device") {
+            options.multiDevice = true;
+        } else if (match_option(arg, "--split", value)) {
+            options.splitRatios.clear();
+            if (value != "learned") {
+                std::istringstream ratios(value);
+                std::string ratio;
+                double ratioSum = 0.0;
+                while (std::getline(ratios, ratio, ',')) {
+                    char* end = nullptr;
+                    double parsed = std::strtod(ratio.c_str(), &end);
+                    if (ratio.empty() || *end != '\0' || !std::isfinite(parsed) || parsed < 0.0) {
+                        std::cerr << "Invalid --split ratio '" << ratio << "' (must be a non-negative number)." << std::endl;
+                        return false;
+                    }
+                    options.splitRatios.push_back(parsed);
+                    ratioSum += parsed;
+                }
+                if (ratioSum <= 0.0) {
+                    std::cerr << "--split ratios must not all be zero." << std::endl;
+                    return false;
+                }
+            }
+        } else if (match_option(arg, "--multi-mb", value)) {
+            options.multiDeviceBytes = std::strtoull(value.c_str(), nullptr, 10) * 1024 * 1024;
+            if (options.multiDeviceBytes == 0) {
+                std::cerr << "--multi-mb must be at least 1." << std::endl;
+                return false;
+            }
+        } else if (match_option(arg, "--peak-table", value)) {
+            if (!load_peak_table(value, options.peakTable)) return false;
+        } else if (match_option(arg, "--kernel", value)) {
+            if (!parse_variants(value, options.variants)) return false;
+        } else if (arg == "--autotune") {
+            options.autotune = true;
+        } else if (arg == "--retune") {
+            options.autotune = true;
+            options.retune = true;
+        } else if (match_option(arg, "--tune-cache", value)) {
+            options.tuningCachePath = value;
+        } else if (match_option(arg, "--binary-cache", value)) {
+            options.binaryCacheDir = value;
+        } else if (arg == "--no-binary-cache") {
+            options.binaryCache = false;
+        } else if (arg == "--host-baseline") {
+            options.hostBaseline = true;
+        } else if (match_option(arg, "--host-threads", value)) {
+            options.hostThreads = std::atoi(value.c_str());
+            size_t cpuCount = allowed_cpus().size();
+            if (options.hostThreads < 1 || (size_t)options.hostThreads > cpuCount) {
+                std::cerr << "--host-threads must be between 1 and " << cpuCount
+                          << ", the CPUs this process may run on." << std::endl;
+                return false;
+            }
+        } else if (match_option(arg, "--transfer", value)) {
+            if (!parse_strategies(value, options.strategies)) return false;
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            print_usage(argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Prints the device details shown by --list
+void print_device_summary(const cl::Device& device) {
+    std::string version, driver;
+    cl_uint computeUnits = 0, clockMHz = 0;
+    cl_ulong globalMem = 0, maxAlloc = 0;
+    device.getInfo(CL_DEVICE_VERSION, &version);
+    device.getInfo(CL_DRIVER_VERSION, &driver);
+    device.getInfo(CL_DEVICE_MAX_COMPUTE_UNITS, &computeUnits);
+    device.getInfo(CL_DEVICE_MAX_CLOCK_FREQUENCY, &clockMHz);
+    device.getInfo(CL_DEVICE_GLOBAL_MEM_SIZE, &globalMem);
+    device.getInfo(CL_DEVICE_MAX_MEM_ALLOC_SIZE, &maxAlloc);
+    std::cout << "    " << version << ", driver " << driver << std::endl;
+    std::cout << "    " << computeUnits << " compute units at " << clockMHz << " MHz, "
+              << globalMem / (1024 * 1024) << " MB global memory (max allocation "
+              << maxAlloc / (1024 * 1024) << " MB)" << std::endl;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    BenchmarkOptions options;
+    if (!parse_options(argc, argv, options)) {
+        return -1;
+    }
+    if (options.help) {
+        print_usage(argv[0]);
+        return 0;
+    }
+
+    // Load the baseline first so a bad path fails before anything is measured
+    std::vector<ResultRecord> baseline;
+    if (!options.baselinePath.empty() && !load_result_records(options.baselinePath, baseline)) {
+        return -1;
+    }
+
+    // Native host reference numbers, measured up front so every device can be compared against them
+    HostBaseline hostBaseline;
+    std::vector<ResultRecord> records; // Everything measured, for --output
+    TraceLog trace;                    // Timeline of every traced command, for --trace
+    TraceLog* tracePtr = options.tracePath.empty() ? nullptr : &trace;
+    if (options.hostBaseline && !options.list) {
+        hostBaseline = run_host_baseline(options);
+        append_host_records(records, hostBaseline);
+        std::cout << std::endl;
+    }
+
     // --- 1. Get all OpenCL Platforms ---
     std::vector<cl::Platform> platforms;
     cl_int err = cl::Platform::get(&platforms);
@@ -177,11 +6619,19 @@ int main() {
 
     std::cout << "--- Discovered OpenCL Platforms and Devices ---" << std::endl;
 
-    // --- 2. Enumerate and Benchmark all Platforms and Devices ---
+    // --- 2. Enumerate and Benchmark the selected Platforms and Devices ---
+    std::vector<cl::Device> allDevices; // Collected for --multi-device and --peer
+    std::vector<cl::Platform> allPlatforms; // Platform of each entry in allDevices
     int platformIdx = 0;
+    int selectedDevices = 0;
     for (const auto& platform : platforms) {
         std::string platformName;
         platform.getInfo(CL_PLATFORM_NAME, &platformName);
+        // Unselected platforms are not asked for devices at all
+        if (!selector_matches(options.platformSelector, platformIdx, platformName)) {
+            platformIdx++;
+            continue;
+        }
 
         std::cout << "\n~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~" << std::endl;
 
@@ -190,8 +6640,10 @@ int main() {
         std::cout << "Platform " << platformIdx << ": " << platformName << " (Version: " << platformVersion << ")" << std::endl;
 
         std::vector<cl::Device> devices;
-        err = platform.getDevices(CL_DEVICE_TYPE_ALL, &devices); // Get all device types for this platform
-        if (err != CL_SUCCESS) {
+        err = platform.getDevices(options.deviceType, &devices); // Only the requested device types
+        if (err == CL_DEVICE_NOT_FOUND) {
+            devices.clear();
+        } else if (err != CL_SUCCESS) {
             std::cerr << "  Error getting devices for platform " << platformName << ": " << err << std::endl;
             platformIdx++;
             continue;
@@ -204,6 +6656,11 @@ int main() {
             for (const auto& device : devices) {
                 std::string deviceName;
                 device.getInfo(CL_DEVICE_NAME, &deviceName);
+                if (!selector_matches(options.deviceSelector, deviceIdx, deviceName)) {
+                    deviceIdx++;
+                    continue;
+                }
+                selectedDevices++;
                 cl_device_type deviceType;
                 device.getInfo(CL_DEVICE_TYPE, &deviceType);
                 std::string typeStr = (deviceType == CL_DEVICE_TYPE_CPU) ? "CPU" :
@@ -213,7 +6670,18 @@ int main() {
                 std::cout << "  Device " << deviceIdx << ": " << deviceName << " (Type: " << typeStr << ")" << std::endl;
 
                 // Call the benchmark function for each discovered device
-                run_benchmark(platform, device);
+                if (options.list) {
+                    print_device_summary(device);
+                } else {
+                    if (options.multiDevice || options.peerTransfers) {
+                        allDevices.push_back(device);
+                        allPlatforms.push_back(platform);
+                    }
+                    // --multi-device replaces the per-device runs; --peer is reported after them
+                    if (!options.multiDevice) {
+                        run_benchmark(platform, device, options, options.hostBaseline ? &hostBaseline : nullptr, tracePtr, records);
+                    }
+                }
 
                 deviceIdx++;
             }
@@ -221,5 +6689,30 @@ int main() {
         platformIdx++;
     }
 
-    return 0;
+    if (selectedDevices == 0) {
+        std::cerr << "No OpenCL device matches the --platform / --device / --device-type selection." << std::endl;
+        return -1;
+    }
+    if (options.list) {
+        return 0;
+    }
+    if (options.multiDevice && !allDevices.empty()) {
+        run_multi_device(allPlatforms, allDevices, options, tracePtr, records);
+    }
+    if (options.peerTransfers) {
+        if (allDevices.size() < 2) {
+            std::cerr << "--peer needs at least two selected devices." << std::endl;
+            return -1;
+        }
+        run_peer_transfers(allPlatforms, allDevices, options, records);
+    }
+
+    int regressions = options.baselinePath.empty() ? 0 : compare_with_baseline(baseline, records, options);
+    if (!options.outputPath.empty() && !write_result_records(options.outputPath, options.outputFormat, records)) {
+        return -1;
+    }
+    if (tracePtr && !write_chrome_trace(options.tracePath, trace)) {
+        return -1;
+    }
+    return regressions > 0 ? 1 : 0;
 }